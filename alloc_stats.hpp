@@ -0,0 +1,86 @@
+#ifndef ALLOC_STATS_HPP
+#define ALLOC_STATS_HPP
+
+#include <atomic>
+#include <new>
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+
+// Counts the allocations through the global operator new. Counting is off
+// by default, it has to be switched on before any other thread is started.
+//
+// The replacement functions below may only be defined once per program,
+// hence this header must only be included by main.cpp (directly or not).
+static bool alloc_stats_enabled = false;
+
+static std::atomic<uint64_t> alloc_cnt{0};
+static std::atomic<uint64_t> alloc_bytes{0};
+
+struct AllocCounts{
+	uint64_t cnt;
+	uint64_t bytes;
+};
+
+static inline AllocCounts alloc_counts(){
+	return AllocCounts{alloc_cnt.load(std::memory_order_relaxed), alloc_bytes.load(std::memory_order_relaxed)};
+}
+
+static inline void* counted_alloc(const size_t size, const bool nothrow){
+	if(alloc_stats_enabled){
+		alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+		alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	const size_t alloc_size = (0 == size) ? 1 : size;
+	while(true){
+		if(void* const ptr = std::malloc(alloc_size))
+			return ptr;
+
+		// Without exceptions bad_alloc cannot be thrown.
+		const std::new_handler handler = std::get_new_handler();
+		if(!handler){
+			if(nothrow)
+				return nullptr;
+
+			std::abort();
+		}
+
+		handler();
+	}
+}
+
+void* operator new(const size_t size){
+	return counted_alloc(size, false);
+}
+
+void* operator new[](const size_t size){
+	return counted_alloc(size, false);
+}
+
+void* operator new(const size_t size, const std::nothrow_t&)noexcept{
+	return counted_alloc(size, true);
+}
+
+void* operator new[](const size_t size, const std::nothrow_t&)noexcept{
+	return counted_alloc(size, true);
+}
+
+void operator delete(void* const ptr)noexcept{
+	std::free(ptr);
+}
+
+void operator delete[](void* const ptr)noexcept{
+	std::free(ptr);
+}
+
+void operator delete(void* const ptr, const size_t /*size*/)noexcept{
+	std::free(ptr);
+}
+
+void operator delete[](void* const ptr, const size_t /*size*/)noexcept{
+	std::free(ptr);
+}
+
+#endif	// ALLOC_STATS_HPP
\ No newline at end of file
@@ -2,16 +2,60 @@
 #define ARG_PARSER_HPP
 
 #include <string>
+#include <vector>
+
+#include <iostream>
 
 #include <cstdlib>
+#include <cstdint>
 
 #include "args.hpp"
 
-static void print_ussage_and_exit(const char* const prog_name){
+static void print_ussage_and_exit(const char* const prog_name, const int status = 0){
 	std::clog << "usage: " << prog_name
-			  << " [<filename>] [--interactive] [--dump-ast] [--dump-sym] [--pythonify] [--try-recovery-from-syntax-errors]\n";
+			  << " [<filename>] [--interactive] [--dump-ast] [--dump-sym] [--dump-temps] [--dump-ranges] [--estimate-cost] [--pythonify] [--optimize] [--hash-cons] [--lazy-parse] [--threads <n>] [--max-steps <n>] [--timeout <ms>] [--cache-dir <dir>] [--cache-dir-limit <MiB>] [--checkpoint <file> [--checkpoint-interval <s>]] [--resume <file>] [--stats | --stats-json] [--try-recovery-from-syntax-errors] [--tree-walker]\n"
+			  << "       " << prog_name << " <filename> --input <file> [--input-format (csv | tsv | int64)] [--columns <a,b,...>] [--outputs <x,y,...>] [--estimate-cost] [--optimize] [--threads <n>] [--max-steps <n>] [--timeout <ms>]\n"
+			  << "       " << prog_name << " --serve <socket> [--workers <n>] [--cache-size <n>] [--slice <iterations>] [--max-request-size <MiB>] [--max-steps <n>] [--timeout <ms>] [--cache-dir <dir>] [--cache-dir-limit <MiB>]\n"
+			  << "       " << prog_name << " --connect <socket> (<filename> | --program <id>) [--dump-ast] [--dump-sym] [--dump-temps] [--dump-ranges] [--estimate-cost] [--pythonify] [--optimize] [--priority <n>] [--max-steps <n>] [--timeout <ms>]\n";
+
+	std::exit(status);
+}
 
-	std::exit(0);
+// The value of the option at 'arg_idx', which is advanced to it. Without
+// a value, the option would be taken for the filename otherwise.
+static const char* option_value(const int argc, const char* const argv[], int& arg_idx){
+	if(arg_idx + 1 >= argc){
+		std::cerr << "error: The option \'" << argv[arg_idx] << "\' needs a value.\n";
+		print_ussage_and_exit(*argv, -1);
+	}
+
+	return argv[++arg_idx];
+}
+
+static uint64_t parse_uint_arg(const char* const arg, const uint64_t max, const char* const prog_name){
+	char* end{};
+	const unsigned long long value = std::strtoull(arg, &end, 10);
+
+	if(end == arg || *end != '\0' || '-' == *arg || value > max)
+		print_ussage_and_exit(prog_name);
+
+	return static_cast<uint64_t>(value);
+}
+
+// Splits a comma separated list, e.g. of variable names.
+static std::vector<std::string> parse_list_arg(const std::string& arg){
+	std::vector<std::string> res{};
+
+	size_t begin = 0;
+	while(true){
+		const size_t end = arg.find(',', begin);
+		res.push_back(arg.substr(begin, end - begin));
+
+		if(std::string::npos == end)
+			return res;
+
+		begin = end + 1;
+	}
 }
 
 static void parse_args(const int argc, const char* const argv[]){
@@ -25,10 +69,76 @@ static void parse_args(const int argc, const char* const argv[]){
 			args.dump_ast = true;
 		else if(arg == "--dump-sym")
 			args.dump_sym_table = true;
+		else if(arg == "--dump-temps")
+			args.dump_temps = true;
+		else if(arg == "--dump-ranges")
+			args.dump_ranges = true;
+		else if(arg == "--estimate-cost")
+			args.estimate_cost = true;
 		else if(arg == "--pythonify")
 			args.pythonify = true;
+		else if(arg == "--optimize")
+			args.optimize = true;
+		else if(arg == "--hash-cons")
+			args.hash_cons = true;
+		else if(arg == "--lazy-parse")
+			args.lazy_parse = true;
+		else if(arg == "--threads")
+			args.threads = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--max-steps")
+			args.max_steps = parse_uint_arg(option_value(argc, argv, arg_idx), UINT64_MAX, *argv);
+		else if(arg == "--timeout")
+			args.timeout_ms = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--checkpoint")
+			args.checkpoint_file = option_value(argc, argv, arg_idx);
+		else if(arg == "--checkpoint-interval")
+			args.checkpoint_interval_s = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--resume")
+			args.resume_file = option_value(argc, argv, arg_idx);
+		else if(arg == "--input")
+			args.input_file = option_value(argc, argv, arg_idx);
+		else if(arg == "--input-format"){
+			const std::string format = option_value(argc, argv, arg_idx);
+			if(format == "csv")
+				args.input_format = RecordFormat::CSV;
+			else if(format == "tsv")
+				args.input_format = RecordFormat::TSV;
+			else if(format == "int64")
+				args.input_format = RecordFormat::INT64;
+			else
+				print_ussage_and_exit(*argv);
+		}else if(arg == "--columns")
+			args.input_columns = parse_list_arg(option_value(argc, argv, arg_idx));
+		else if(arg == "--outputs")
+			args.output_vars = parse_list_arg(option_value(argc, argv, arg_idx));
+		else if(arg == "--stats")
+			args.stats = true;
+		else if(arg == "--stats-json")
+			args.stats = args.stats_json = true;
+		else if(arg == "--cache-dir")
+			args.cache_dir = option_value(argc, argv, arg_idx);
+		else if(arg == "--cache-dir-limit")
+			args.cache_dir_limit = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--serve")
+			args.serve_socket = option_value(argc, argv, arg_idx);
+		else if(arg == "--workers")
+			args.workers = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--cache-size")
+			args.cache_size = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--slice")
+			args.slice = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--max-request-size")
+			args.max_request_size = parse_uint_arg(option_value(argc, argv, arg_idx), UINT32_MAX, *argv);
+		else if(arg == "--connect")
+			args.connect_socket = option_value(argc, argv, arg_idx);
+		else if(arg == "--program")
+			args.program_id = option_value(argc, argv, arg_idx);
+		else if(arg == "--priority")
+			args.priority = parse_uint_arg(option_value(argc, argv, arg_idx), 1000, *argv);
 		else if(arg == "--try-recovery-from-syntax-errors")
 			args.try_recovery_from_syntax_errors = true;
+		else if(arg == "--tree-walker")
+			args.tree_walker = true;
 		else if(!file_specified){
 			args.filename = arg;
 			file_specified = true;
@@ -36,9 +146,21 @@ static void parse_args(const int argc, const char* const argv[]){
 			print_ussage_and_exit(*argv);
 	}
 
+	// The server reads its programs from the clients.
+	if(!args.serve_socket.empty()){
+		if(file_specified || args.interactive_mode || !args.connect_socket.empty())
+			print_ussage_and_exit(*argv);
+
+		return;
+	}
+
+	// A client sends either a file or the id of a cached program.
+	if(!args.program_id.empty() && (file_specified || args.connect_socket.empty()))
+		print_ussage_and_exit(*argv);
+
 	// Either in interactive mode and no file
 	// or a file but not in interactive mode.
-	if(file_specified == args.interactive_mode)
+	if(args.program_id.empty() && file_specified == args.interactive_mode)
 		print_ussage_and_exit(*argv);
 }
 
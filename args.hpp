@@ -2,16 +2,64 @@
 #define ARGS_HPP
 
 #include <string>
+#include <vector>
+
+#include <cstdint>
+
+enum class RecordFormat: uint8_t{
+	CSV,
+	TSV,
+	INT64		// native int64 values, one after another
+};
 
 struct CommandLineArguments{
 	bool dump_ast = false;
 	bool dump_sym_table = false;
+	bool dump_temps = false;
+	bool dump_ranges = false;
+	bool estimate_cost = false;
 
 	bool pythonify = false;
 	bool interactive_mode = false;
 
+	bool optimize = false;
+	bool hash_cons = false;
+	bool lazy_parse = false;
+	uint32_t threads = 1;
+
+	uint64_t max_steps = 0;
+	uint32_t timeout_ms = 0;
+
+	std::string checkpoint_file{};
+	uint32_t checkpoint_interval_s = 60;
+	std::string resume_file{};
+
+	std::string input_file{};
+	RecordFormat input_format = RecordFormat::CSV;
+	std::vector<std::string> input_columns{};
+	std::vector<std::string> output_vars{"result"};
+
+	bool stats = false;
+	bool stats_json = false;
+
+	std::string cache_dir{};
+	uint32_t cache_dir_limit = 64;	// MiB
+
+	std::string serve_socket{};
+	uint32_t workers = 0;
+	uint32_t cache_size = 64;
+	uint32_t slice = 16384;		// loop iterations
+	uint32_t max_request_size = 64;	// MiB
+
+	std::string connect_socket{};
+	std::string program_id{};
+	uint32_t priority = 1;
+
 	bool try_recovery_from_syntax_errors = false;
 
+	// Evaluates the AST even if the program could run on the VM, e.g. for benchmarks.
+	bool tree_walker = false;
+
 	std::string filename{};
 };
 
@@ -2,21 +2,135 @@
 #define AST_HPP
 
 #include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <sstream>
+#include <ostream>
+
+#include <cstdint>
 
 #include "ast_node.hpp"
+#include "shared_nodes.hpp"
+#include "lazy_node.hpp"
+#include "bytecode.hpp"
+#include "line_index.hpp"
+#include "parallel.hpp"
 #include "sym_table.hpp"
+#include "temp_pool.hpp"
 #include "types.hpp"
+#include "util.hpp"
 
 class Ast{
 	private:
-		std::unique_ptr<BaseNode> m_root;
+		// Destroyed after the tree, nullptr unless the expressions are hash-consed.
+		std::unique_ptr<SharedNodes> m_shared_nodes;
+
+		NodePtr m_root;
+
+		// The source code the nodes refer to.
+		std::string_view m_code;
+
+		// Owns the names of the temporaries introduced by optimize().
+		TempPool m_temps;
+
+		// nullptr unless the bodies are parsed lazily.
+		std::shared_ptr<LazyErrors> m_lazy_errors;
 
 	public:
-		Ast(BaseNode* const root): m_root{root}{
+		Ast(
+				BaseNode* const root,
+				const std::string_view& code,
+				std::unique_ptr<SharedNodes> shared_nodes = nullptr,
+				std::shared_ptr<LazyErrors> lazy_errors = nullptr
+			):
+				m_shared_nodes{std::move(shared_nodes)},
+				m_root{root},
+				m_code{code},
+				m_temps{},
+				m_lazy_errors{std::move(lazy_errors)}{
+		}
+
+		// False if a body parsed lazily so far has a syntax error, which
+		// stops the evaluation, see LazyNode.
+		inline bool lazy_ok()const{
+			return !this->m_lazy_errors || !this->m_lazy_errors->fatal();
 		}
 
-		inline IntType eval(SymbolTable& sym_table)const{
-			this->m_root->eval(sym_table);
+		// Writes the syntax errors of the bodies parsed lazily since the last
+		// call, returns lazy_ok().
+		bool report_lazy_errors(std::ostream& os)const{
+			if(this->m_lazy_errors)
+				os << this->m_lazy_errors->take();
+
+			return this->lazy_ok();
+		}
+
+		// Loop-invariant code motion runs first so that the
+		// hoisted expressions take part in the elimination of
+		// common subexpressions within the loop preheaders.
+		// The ranges are only of use to programs with lists.
+		inline void optimize(){
+			BaseNode* const replacement = this->m_root->optimize_loops(this->m_temps);
+			if(replacement){
+				this->m_root.release();
+				this->m_root.reset(replacement);
+			}
+
+			this->m_root->eliminate_common_subexprs(this->m_temps);
+
+			NodeCounts counts{};
+			this->m_root->count_nodes(counts);
+			if(counts[static_cast<size_t>(NodeKind::LIST)] > 0 || counts[static_cast<size_t>(NodeKind::RANGE)] > 0){
+				RangeAnalysis ra{};
+				ra.run(*this->m_root);
+				ra.apply();
+			}
+		}
+
+		inline BaseNode& root(){
+			return *this->m_root;
+		}
+
+		Program compile()const{
+			BytecodeCompiler bc{};
+			this->m_root->compile(bc);
+
+			return bc.finish();
+		}
+
+		inline void count_nodes(NodeCounts& counts)const{
+			this->m_root->count_nodes(counts);
+		}
+
+		// The code has moved, e.g. after an edit.
+		inline void set_code(const std::string_view& code){
+			this->m_code = code;
+		}
+
+		// Equal for programs which only differ in white space.
+		inline uint64_t hash()const{
+			return this->m_root->hash(FNV_OFFSET_BASIS);
+		}
+
+		// The program as Python, equal for programs which only differ in white space.
+		// Unlike the hash, it tells programs apart.
+		inline std::string normalized()const{
+			std::ostringstream oss{};
+			this->m_root->pythonify(oss, 0);
+
+			return oss.str();
+		}
+
+		inline IntType eval(SymbolTable& sym_table, const uint32_t thread_cnt = 1)const{
+			if(thread_cnt > 1 && NodeKind::INSTR_LIST == this->m_root->kind()){
+				ParallelExecutor executor{static_cast<const InstrListNode&>(*this->m_root)};
+				executor.eval(sym_table, thread_cnt);
+			}else
+				this->m_root->eval(sym_table);
+
 			return sym_table.get_or_insert("result");
 		}
 
@@ -25,7 +139,31 @@ class Ast{
 		}
 
 		inline void dump(std::ostream& os)const{
-			this->m_root->dump(os << "Ast:\n", 1);
+			LineIndex lines{this->m_code};
+			DumpContext ctx{lines};
+			this->m_root->dump(os << "Ast:\n", ctx, 1);
+		}
+
+		// Only reports the ranges, the nodes remain unchanged.
+		inline void dump_ranges(std::ostream& os, const bool with_temps)const{
+			RangeAnalysis ra{};
+			ra.run(*this->m_root);
+
+			LineIndex lines{this->m_code};
+			ra.dump(os, lines, with_temps);
+		}
+
+		// See CostEstimate, written as a single line of JSON. The
+		// inputs are integers whose values are unknown, e.g. columns.
+		inline void estimate_cost(std::ostream& os, const std::vector<std::string>& inputs = {})const{
+			LineIndex lines{this->m_code};
+
+			CostEstimate ce{lines};
+			for(const std::string& input : inputs)
+				ce.store(input, CostValue::of_int(Interval::full()));
+
+			ce.run(*this->m_root);
+			ce.print_json(os);
 		}
 };
 
@@ -1,39 +1,280 @@
 #ifndef AST_NODE_HPP
 #define AST_NODE_HPP
 
+#include <map>
 #include <list>
+#include <array>
+#include <tuple>
+#include <vector>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 #include <sstream>
 #include <string_view>
+#include <utility>
 
 #include <cstdint>
 
 #include "types.hpp"
+#include "value.hpp"
+#include "util.hpp"
+#include "bytecode.hpp"
+#include "list_kernels.hpp"
+#include "interval.hpp"
+#include "cost.hpp"
 #include "sym_table.hpp"
+#include "exec_limits.hpp"
+#include "temp_pool.hpp"
+#include "relocation.hpp"
+#include "line_index.hpp"
 #include "token_position.hpp"
 
+enum class NodeKind: uint8_t{
+	ERROR,
+
+	INT,
+	VAR,
+
+	ADD,
+	SUB,
+	MUL,
+
+	ASSIGN,
+	IF,
+	WHILE,
+
+	INSTR_LIST,
+	LAZY,
+
+	LIST,
+	RANGE,
+	AT,
+	LEN,
+	SUM,
+	PROD,
+	MAX,
+
+	IMPORT
+};
+
+static constexpr const char* const node_kind_names[] = {
+	"ERROR",
+
+	"INT",
+	"VAR",
+
+	"ADD",
+	"SUB",
+	"MUL",
+
+	"ASSIGN",
+	"IF",
+	"WHILE",
+
+	"INSTR_LIST",
+	"LAZY",
+
+	"LIST",
+	"RANGE",
+	"AT",
+	"LEN",
+	"SUM",
+	"PROD",
+	"MAX",
+
+	"IMPORT"
+};
+
+static constexpr size_t NODE_KIND_CNT = sizeof(node_kind_names) / sizeof(*node_kind_names);
+
+static inline const char* node_kind_name(const NodeKind kind){
+	return node_kind_names[static_cast<uint8_t>(kind)];
+}
+
+// Number of nodes per kind.
+using NodeCounts = std::array<uint64_t, NODE_KIND_CNT>;
+
+class BaseNode;
+
+// Shared nodes are owned by SharedNodes instead of their parents.
+struct NodeDeleter{
+	inline void operator()(BaseNode* const node)const;
+};
+
+using NodePtr = std::unique_ptr<BaseNode, NodeDeleter>;
+
+using NodeList = std::list<NodePtr>;
+using VarSet = std::unordered_set<std::string_view>;
+
+// State of a single dump, shared nodes are numbered in the order of their first occurrence.
+class DumpContext{
+	private:
+		LineIndex& m_lines;
+		std::unordered_map<const BaseNode*, uint32_t> m_shared_ids;
+
+	public:
+		explicit DumpContext(LineIndex& lines): m_lines{lines}, m_shared_ids{}{
+		}
+
+		inline SourceLocation locate(const TokenPosition& pos){
+			return this->m_lines.locate(pos);
+		}
+
+		// Returns the id of a shared node and whether the node has been dumped before.
+		std::pair<uint32_t, bool> visit(const BaseNode& node){
+			const auto res = this->m_shared_ids.try_emplace(&node, static_cast<uint32_t>(this->m_shared_ids.size()) + 1);
+			return {res.first->second, !res.second};
+		}
+};
+
+class SharedNodes;
+
+// Evaluate leafs without a virtual call, see below.
+inline IntType eval_node(const BaseNode& node, SymbolTable& sym_table);
+inline Value eval_value_node(const BaseNode& node, SymbolTable& sym_table);
+
+class InstrListNode;
+class LoopInvariants;
+class ValueNumbering;
+class RangeAnalysis;
+class CostEstimate;
+
 class BaseNode{
 	protected:
+		const NodeKind m_kind;
+
+		// Set by SharedNodes, a shared node may have several parents.
+		bool m_shared;
+
+		// Set if the expression contains an operator which creates a list.
+		bool m_may_yield_list;
+
 		TokenPosition m_pos;
 
+		friend class SharedNodes;
+
 	public:
-		explicit BaseNode(const TokenPosition& pos): m_pos{pos}{
+		BaseNode(const NodeKind kind, const TokenPosition& pos):
+			m_kind{kind}, m_shared{false}, m_may_yield_list{false}, m_pos{pos}{
+		}
+
+		inline NodeKind kind()const{
+			return this->m_kind;
+		}
+
+		inline bool shared()const{
+			return this->m_shared;
 		}
 
 		inline const TokenPosition& pos()const{
 			return this->m_pos;
 		}
 
+		// Unless the symbol table holds lists, see SymbolTable::holds_lists().
+		inline bool may_yield_list()const{
+			return this->m_may_yield_list;
+		}
+
+		// The node which is evaluated in place of this one, see LazyNode.
+		virtual const BaseNode& resolve()const{
+			return *this;
+		}
+
+		// Where an integer is expected, lists count as their length.
 		virtual IntType eval(SymbolTable& sym_table)const = 0;
 
+		// Only expressions which may yield a list override this.
+		virtual Value eval_value(SymbolTable& sym_table)const{
+			return Value{this->eval(sym_table)};
+		}
+
 		virtual void pythonify(std::ostream& os, const uint16_t depth)const = 0;
 
-		virtual void dump(std::ostream& os, const uint16_t depth)const = 0;
+		virtual void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const = 0;
+
+		virtual BaseNode* clone()const = 0;
+
+		// Adds every variable the node (or one of its children) reads or assigns.
+		virtual void collect_vars(VarSet& reads, VarSet& writes)const = 0;
+
+		// Adds every variable the instruction (or one of its children) may
+		// assign a list, given that the variables in 'lists' may hold one.
+		virtual void collect_list_vars(VarSet& /*lists*/)const{
+		}
+
+		// Called on nodes which are evaluated in every iteration of a loop.
+		// Returns true if the value of the node is invariant within the loop,
+		// otherwise hoists the invariant arithmetic subtrees into 'loop'.
+		virtual bool hoist_invariants(LoopInvariants& /*loop*/){
+			return false;
+		}
+
+		// Applies loop-invariant code motion to every loop below this node.
+		// Returns the node which replaces this one or nullptr.
+		virtual BaseNode* optimize_loops(TempPool& /*temps*/){
+			return nullptr;
+		}
+
+		// Assigns a value number to the node (and its children) within
+		// the straight-line region of an instruction list.
+		virtual uint32_t number_values(ValueNumbering& vn)const;
+
+		// Replaces the subexpressions of the node whose value has already
+		// been computed within the region by temporaries.
+		virtual void replace_common_subexprs(ValueNumbering& /*vn*/){
+		}
+
+		// Applies common subexpression elimination to every instruction list below this node.
+		virtual void eliminate_common_subexprs(TempPool& /*temps*/){
+		}
+
+		// Moves the node (and its children) to the relocated source code.
+		virtual void relocate(const Relocation& rel){
+			this->m_pos = rel.apply(this->m_pos);
+		}
+
+		// Adds the instruction lists which are direct children of the node.
+		virtual void collect_instr_lists(std::vector<InstrListNode*>& /*lists*/){
+		}
+
+		// Folds the structure of the node (and its children) into 'seed',
+		// positions and therefore white space do not contribute.
+		virtual uint64_t hash(const uint64_t seed)const{
+			return BaseNode::hash_bytes(this->m_kind, seed);
+		}
+
+		virtual void count_nodes(NodeCounts& counts)const{
+			++counts[static_cast<uint8_t>(this->m_kind)];
+		}
+
+		// Returns the values of an expression, 'as_int' is set where an integer
+		// is expected, see eval(). Instructions update the state of 'ra' instead.
+		virtual ValueRange analyze_ranges(RangeAnalysis& /*ra*/, const bool /*as_int*/){
+			return ValueRange::of_int(Interval::full());
+		}
+
+		// Returns the values of an expression and adds the evaluations of the
+		// node (and its children) to 'ce'. Instructions update its state instead.
+		virtual CostValue estimate_cost(CostEstimate& ce)const;
+
+		// Expressions leave their value on the stack, instructions leave it empty.
+		virtual void compile(BytecodeCompiler& bc)const = 0;
 
 		virtual ~BaseNode() = default;
 
 	protected:
+		template <typename T>
+		static inline uint64_t hash_bytes(const T& value, const uint64_t seed){
+			return fnv1a(std::string_view{reinterpret_cast<const char*>(&value), sizeof(T)}, seed);
+		}
+
+		// The length separates adjacent names.
+		static inline uint64_t hash_name(const std::string_view& name, const uint64_t seed){
+			return fnv1a(name, BaseNode::hash_bytes(static_cast<uint32_t>(name.size()), seed));
+		}
+
 		static void indent_n(std::ostream& os, const uint16_t n){
 			for(uint16_t i = 0; i < n; ++i)
 				os << "  ";
@@ -46,11 +287,45 @@ class BaseNode{
 
 			os << "+--";
 		}
+
+		// Shared nodes are dumped once, every further occurrence refers to the first one.
+		bool dump_reference(std::ostream& os, DumpContext& ctx, const char* const name, const uint16_t depth)const{
+			if(!this->m_shared)
+				return false;
+
+			const auto id = ctx.visit(*this);
+			if(!id.second)
+				return false;
+
+			BaseNode::dump_placeholder(os, depth);
+			os << name << "[-> #" << id.first << "]\n";
+
+			return true;
+		}
+
+		// Appended to the location of a shared node.
+		void dump_shared_id(std::ostream& os, DumpContext& ctx)const{
+			if(this->m_shared)
+				os << ", #" << ctx.visit(*this).first;
+		}
+
+		static void optimize_loops_of(NodePtr& node, TempPool& temps){
+			BaseNode* const replacement = node->optimize_loops(temps);
+			if(replacement){
+				node.release();
+				node.reset(replacement);
+			}
+		}
 };
 
-class ErrorNode: public BaseNode{
+inline void NodeDeleter::operator()(BaseNode* const node)const{
+	if(node && !node->shared())
+		delete node;
+}
+
+class ErrorNode final: public BaseNode{
 	public:
-		explicit ErrorNode(const TokenPosition& pos): BaseNode{pos}{
+		explicit ErrorNode(const TokenPosition& pos): BaseNode{NodeKind::ERROR, pos}{
 		}
 
 		IntType eval(SymbolTable& /*sym_table*/)const override{
@@ -62,87 +337,258 @@ class ErrorNode: public BaseNode{
 			os << "assert false\n";
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
 			BaseNode::dump_placeholder(os, depth);
-			os << "ErrorNode[" << this->m_pos << "]\n";
+			os << "ErrorNode[" << ctx.locate(this->m_pos) << "]\n";
+		}
+
+		BaseNode* clone()const override{
+			return new ErrorNode{this->m_pos};
+		}
+
+		// An instruction list skips erroneous instructions, i.e. this is an expression.
+		void compile(BytecodeCompiler& bc)const override{
+			bc.emit_push(IntType{});
+		}
+
+		void collect_vars(VarSet& /*reads*/, VarSet& /*writes*/)const override{
 		}
 };
 
-class IntNode: public BaseNode{
+class IntNode final: public BaseNode{
 	private:
 		const IntType m_value;
 
 	public:
 		IntNode(const IntType value, const TokenPosition& pos):
-			BaseNode{pos}, m_value{value}{
+			BaseNode{NodeKind::INT, pos}, m_value{value}{
+		}
+
+		inline IntType value()const{
+			return this->m_value;
 		}
 
 		IntType eval(SymbolTable& /*sym_table*/)const override{
 			return this->m_value;
 		}
 
+		Value eval_value(SymbolTable& /*sym_table*/)const override{
+			return Value{this->m_value};
+		}
+
 		void pythonify(std::ostream& os, const uint16_t /*depth*/)const override{
 			os << this->m_value;
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			if(this->dump_reference(os, ctx, "IntNode", depth))
+				return;
+
 			BaseNode::dump_placeholder(os, depth);
-			os << "IntNode[" << this->m_value << ", " << this->m_pos << "]\n";
+			os << "IntNode[" << this->m_value << ", " << ctx.locate(this->m_pos);
+			this->dump_shared_id(os, ctx);
+			os << "]\n";
+		}
+
+		BaseNode* clone()const override{
+			return new IntNode{this->m_value, this->m_pos};
+		}
+
+		void collect_vars(VarSet& /*reads*/, VarSet& /*writes*/)const override{
+		}
+
+		bool hoist_invariants(LoopInvariants& /*loop*/)override{
+			return true;
+		}
+
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		ValueRange analyze_ranges(RangeAnalysis& /*ra*/, const bool /*as_int*/)override{
+			return ValueRange::of_int(Interval::point(this->m_value));
+		}
+
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		uint64_t hash(const uint64_t seed)const override{
+			return BaseNode::hash_bytes(this->m_value, BaseNode::hash(seed));
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			bc.emit_push(this->m_value);
 		}
 };
 
-class VarNode: public BaseNode{
+class VarNode final: public BaseNode{
 	private:
-		const std::string_view m_var_name;
+		std::string_view m_var_name;
 
 	public:
 		VarNode(const std::string_view& var_name, const TokenPosition& pos):
-			BaseNode{pos}, m_var_name{var_name}{
+			BaseNode{NodeKind::VAR, pos}, m_var_name{var_name}{
+		}
+
+		inline const std::string_view& var_name()const{
+			return this->m_var_name;
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
 			return sym_table.get_or_insert(std::string{this->m_var_name});
 		}
 
+		// Copies a list by reference only.
+		Value eval_value(SymbolTable& sym_table)const override{
+			return sym_table.get_value_or_insert(std::string{this->m_var_name});
+		}
+
 		void pythonify(std::ostream& os, const uint16_t /*depth*/)const override{
 			os << this->m_var_name;
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			if(this->dump_reference(os, ctx, "VarNode", depth))
+				return;
+
 			BaseNode::dump_placeholder(os, depth);
-			os << "VarNode[" << this->m_var_name << ", " << this->m_pos << "]\n";
+			os << "VarNode[" << this->m_var_name << ", " << ctx.locate(this->m_pos);
+			this->dump_shared_id(os, ctx);
+			os << "]\n";
+		}
+
+		BaseNode* clone()const override{
+			return new VarNode{this->m_var_name, this->m_pos};
+		}
+
+		void collect_vars(VarSet& reads, VarSet& /*writes*/)const override{
+			reads.insert(this->m_var_name);
+		}
+
+		bool hoist_invariants(LoopInvariants& loop)override;
+
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_var_name = rel.apply(this->m_var_name);
+		}
+
+		uint64_t hash(const uint64_t seed)const override{
+			return BaseNode::hash_name(this->m_var_name, BaseNode::hash(seed));
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			bc.emit_load(this->m_var_name);
 		}
 };
 
 class ArithNode: public BaseNode{
 	protected:
-		std::unique_ptr<BaseNode> m_param1;
-		std::unique_ptr<BaseNode> m_param2;
+		NodePtr m_param1;
+		NodePtr m_param2;
 
 	public:
 		ArithNode(
+				const NodeKind kind,
 				BaseNode* const param1,
 				BaseNode* const param2,
 				const TokenPosition& pos
 			):
-				BaseNode{pos},
+				BaseNode{kind, pos},
 				m_param1{param1},
 				m_param2{param2}{
+
+			this->m_may_yield_list = (param1 && param1->may_yield_list()) || (param2 && param2->may_yield_list());
+		}
+
+		inline const BaseNode* param1()const{
+			return this->m_param1.get();
+		}
+
+		inline const BaseNode* param2()const{
+			return this->m_param2.get();
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->m_param1->collect_vars(reads, writes);
+			this->m_param2->collect_vars(reads, writes);
+		}
+
+		bool hoist_invariants(LoopInvariants& loop)override;
+
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		void replace_common_subexprs(ValueNumbering& vn)override;
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_param1->relocate(rel);
+			this->m_param2->relocate(rel);
+		}
+
+		uint64_t hash(const uint64_t seed)const override{
+			return this->m_param2->hash(this->m_param1->hash(BaseNode::hash(seed)));
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			this->m_param1->count_nodes(counts);
+			this->m_param2->count_nodes(counts);
+		}
+
+	protected:
+		// Applies the operation element-wise if either operand is a list,
+		// a scalar operand is broadcast and the shorter list wins.
+		template <typename Op>
+		Value eval_value_with(SymbolTable& sym_table)const{
+			const Value param1 = eval_value_node(*this->m_param1, sym_table);
+			const Value param2 = eval_value_node(*this->m_param2, sym_table);
+
+			if(!param1.is_list() && !param2.is_list())
+				return Value{Op::apply(param1.as_int(), param2.as_int())};
+
+			size_t n = param1.is_list() ? param1.list().size() : param2.list().size();
+			if(param1.is_list() && param2.is_list())
+				n = std::min(n, param2.list().size());
+
+			auto res = std::make_shared<IntList>(n);
+			exec_limits.for_blocks(n, [&param1, &param2, &res](const size_t begin, const size_t end){
+				ListKernels::zip<Op>(ArithNode::operand(param1, begin), ArithNode::operand(param2, begin), res->data() + begin, end - begin);
+			});
+
+			return Value{std::move(res)};
+		}
+
+	private:
+		static inline ListOperand operand(const Value& value, const size_t begin){
+			return value.is_list()
+				? ListOperand{value.list().data() + begin, IntType{}}
+				: ListOperand{nullptr, value.as_int()};
 		}
 };
 
-class AddNode: public ArithNode{
+class AddNode final: public ArithNode{
 	public:
 		AddNode(
 				BaseNode* const param1,
 				BaseNode* const param2,
 				const TokenPosition& pos
 			):
-				ArithNode{param1, param2, pos}{
+				ArithNode{NodeKind::ADD, param1, param2, pos}{
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
-			return this->m_param1->eval(sym_table) + this->m_param2->eval(sym_table);
+			return eval_node(*this->m_param1, sym_table) + eval_node(*this->m_param2, sym_table);
+		}
+
+		Value eval_value(SymbolTable& sym_table)const override{
+			return this->eval_value_with<AddOp>(sym_table);
 		}
 
 		void pythonify(std::ostream& os, const uint16_t depth)const override{
@@ -153,27 +599,46 @@ class AddNode: public ArithNode{
 			os << ')';
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			if(this->dump_reference(os, ctx, "AddNode", depth))
+				return;
+
 			BaseNode::dump_placeholder(os, depth);
-			os << "AddNode[" << this->m_pos << "]:\n";
+			os << "AddNode[" << ctx.locate(this->m_pos);
+			this->dump_shared_id(os, ctx);
+			os << "]:\n";
+
+			this->m_param1->dump(os, ctx, depth + 1);
+			this->m_param2->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new AddNode{this->m_param1->clone(), this->m_param2->clone(), this->m_pos};
+		}
 
-			this->m_param1->dump(os, depth + 1);
-			this->m_param2->dump(os, depth + 1);
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_param1->compile(bc);
+			this->m_param2->compile(bc);
+			bc.emit_arith(OpCode::ADD);
 		}
 };
 
-class SubNode: public ArithNode{
+class SubNode final: public ArithNode{
 	public:
 		SubNode(
 				BaseNode* const param1,
 				BaseNode* const param2,
 				const TokenPosition& pos
 			):
-				ArithNode{param1, param2, pos}{
+				ArithNode{NodeKind::SUB, param1, param2, pos}{
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
-			return this->m_param1->eval(sym_table) - this->m_param2->eval(sym_table);
+			return eval_node(*this->m_param1, sym_table) - eval_node(*this->m_param2, sym_table);
+		}
+
+		Value eval_value(SymbolTable& sym_table)const override{
+			return this->eval_value_with<SubOp>(sym_table);
 		}
 
 		void pythonify(std::ostream& os, const uint16_t depth)const override{
@@ -184,27 +649,56 @@ class SubNode: public ArithNode{
 			os << ')';
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			if(this->dump_reference(os, ctx, "SubNode", depth))
+				return;
+
 			BaseNode::dump_placeholder(os, depth);
-			os << "SubNode[" << this->m_pos << "]:\n";
+			os << "SubNode[" << ctx.locate(this->m_pos);
+			this->dump_shared_id(os, ctx);
+			os << "]:\n";
+
+			this->m_param1->dump(os, ctx, depth + 1);
+			this->m_param2->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new SubNode{this->m_param1->clone(), this->m_param2->clone(), this->m_pos};
+		}
 
-			this->m_param1->dump(os, depth + 1);
-			this->m_param2->dump(os, depth + 1);
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_param1->compile(bc);
+			this->m_param2->compile(bc);
+			bc.emit_arith(OpCode::SUB);
 		}
 };
 
-class MulNode: public ArithNode{
+class MulNode final: public ArithNode{
+	private:
+		// Set if the elements of list operands fit in 32 bits, see RangeAnalysis.
+		bool m_narrow;
+
 	public:
 		MulNode(
 				BaseNode* const param1,
 				BaseNode* const param2,
 				const TokenPosition& pos
 			):
-				ArithNode{param1, param2, pos}{
+				ArithNode{NodeKind::MUL, param1, param2, pos}, m_narrow{false}{
+		}
+
+		inline void set_narrow(const bool narrow){
+			this->m_narrow = narrow;
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
-			return this->m_param1->eval(sym_table) * this->m_param2->eval(sym_table);
+			return eval_node(*this->m_param1, sym_table) * eval_node(*this->m_param2, sym_table);
+		}
+
+		Value eval_value(SymbolTable& sym_table)const override{
+			return this->m_narrow
+				? this->eval_value_with<NarrowMulOp>(sym_table)
+				: this->eval_value_with<MulOp>(sym_table);
 		}
 
 		void pythonify(std::ostream& os, const uint16_t depth)const override{
@@ -213,25 +707,40 @@ class MulNode: public ArithNode{
 			this->m_param2->pythonify(os, depth);
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			if(this->dump_reference(os, ctx, "MulNode", depth))
+				return;
+
 			BaseNode::dump_placeholder(os, depth);
-			os << "MulNode[" << this->m_pos << "]:\n";
+			os << "MulNode[" << ctx.locate(this->m_pos);
+			this->dump_shared_id(os, ctx);
+			os << "]:\n";
+
+			this->m_param1->dump(os, ctx, depth + 1);
+			this->m_param2->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new MulNode{this->m_param1->clone(), this->m_param2->clone(), this->m_pos};
+		}
 
-			this->m_param1->dump(os, depth + 1);
-			this->m_param2->dump(os, depth + 1);
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_param1->compile(bc);
+			this->m_param2->compile(bc);
+			bc.emit_arith(OpCode::MUL);
 		}
 };
 
 class InstrNode: public BaseNode{
 	public:
-		explicit InstrNode(const TokenPosition& pos): BaseNode{pos}{
+		InstrNode(const NodeKind kind, const TokenPosition& pos): BaseNode{kind, pos}{
 		}
 };
 
-class AssignNode: public InstrNode{
+class AssignNode final: public InstrNode{
 	private:
 		std::string_view m_var_name;
-		std::unique_ptr<BaseNode> m_value;
+		NodePtr m_value;
 
 	public:
 		AssignNode(
@@ -239,14 +748,23 @@ class AssignNode: public InstrNode{
 				BaseNode* const value,
 				const TokenPosition& pos
 			):
-				InstrNode{pos}, m_var_name{var_name}, m_value{value}{
+				InstrNode{NodeKind::ASSIGN, pos}, m_var_name{var_name}, m_value{value}{
+		}
+
+		inline const std::string_view& var_name()const{
+			return this->m_var_name;
+		}
+
+		inline const BaseNode* value()const{
+			return this->m_value.get();
 		}
 
+		// Programs without lists take the faster path.
 		IntType eval(SymbolTable& sym_table)const override{
-			sym_table.update(
-				std::string{this->m_var_name},
-				this->m_value->eval(sym_table)
-			);
+			if(this->m_value->may_yield_list() || sym_table.holds_lists())
+				sym_table.update(std::string{this->m_var_name}, eval_value_node(*this->m_value, sym_table));
+			else
+				sym_table.update(std::string{this->m_var_name}, eval_node(*this->m_value, sym_table));
 
 			return IntType{};
 		}
@@ -258,19 +776,60 @@ class AssignNode: public InstrNode{
 			os << '\n';
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
 			BaseNode::dump_placeholder(os, depth);
-			os << "SetNode[" << this->m_var_name << ", " << this->m_pos << "]:\n";
+			os << "SetNode[" << this->m_var_name << ", " << ctx.locate(this->m_pos) << "]:\n";
 
-			this->m_value->dump(os, depth + 1);
+			this->m_value->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new AssignNode{this->m_var_name, this->m_value->clone(), this->m_pos};
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->m_value->collect_vars(reads, writes);
+			writes.insert(this->m_var_name);
+		}
+
+		void collect_list_vars(VarSet& lists)const override;
+
+		bool hoist_invariants(LoopInvariants& loop)override;
+
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		void replace_common_subexprs(ValueNumbering& vn)override;
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_var_name = rel.apply(this->m_var_name);
+			this->m_value->relocate(rel);
+		}
+
+		uint64_t hash(const uint64_t seed)const override{
+			return this->m_value->hash(BaseNode::hash_name(this->m_var_name, BaseNode::hash(seed)));
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			this->m_value->count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_value->compile(bc);
+			bc.emit_store(this->m_var_name);
 		}
 };
 
-class IfNode: public InstrNode{
+class IfNode final: public InstrNode{
 	private:
-		std::unique_ptr<BaseNode> m_cond;
-		std::unique_ptr<BaseNode> m_if_branch;
-		std::unique_ptr<BaseNode> m_else_branch;
+		NodePtr m_cond;
+		NodePtr m_if_branch;
+		NodePtr m_else_branch;
 
 	public:
 		IfNode(
@@ -279,14 +838,14 @@ class IfNode: public InstrNode{
 				BaseNode* const else_branch,
 				const TokenPosition& pos
 			):
-				InstrNode{pos},
+				InstrNode{NodeKind::IF, pos},
 				m_cond{cond},
 				m_if_branch{if_branch},
 				m_else_branch{else_branch}{
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
-			if(this->m_cond->eval(sym_table) > IntType{})
+			if(eval_node(*this->m_cond, sym_table) > IntType{})
 				this->m_if_branch->eval(sym_table);
 			else
 				this->m_else_branch->eval(sym_table);
@@ -306,20 +865,98 @@ class IfNode: public InstrNode{
 			os << '\n';
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
 			BaseNode::dump_placeholder(os, depth);
-			os << "FuncIfNode[" << this->m_pos << "]:\n";
+			os << "FuncIfNode[" << ctx.locate(this->m_pos) << "]:\n";
+
+			this->m_cond->dump(os, ctx, depth + 1);
+			this->m_if_branch->dump(os, ctx, depth + 1);
+			this->m_else_branch->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new IfNode{
+				this->m_cond->clone(),
+				this->m_if_branch->clone(),
+				this->m_else_branch->clone(),
+				this->m_pos
+			};
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->m_cond->collect_vars(reads, writes);
+			this->m_if_branch->collect_vars(reads, writes);
+			this->m_else_branch->collect_vars(reads, writes);
+		}
+
+		void collect_list_vars(VarSet& lists)const override{
+			this->m_if_branch->collect_list_vars(lists);
+			this->m_else_branch->collect_list_vars(lists);
+		}
+
+		// Only the condition is evaluated in every iteration.
+		bool hoist_invariants(LoopInvariants& loop)override;
+
+		BaseNode* optimize_loops(TempPool& temps)override{
+			BaseNode::optimize_loops_of(this->m_if_branch, temps);
+			BaseNode::optimize_loops_of(this->m_else_branch, temps);
+
+			return nullptr;
+		}
+
+		// The condition is the last expression of the region in front of the branches.
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		void replace_common_subexprs(ValueNumbering& vn)override;
 
-			this->m_cond->dump(os, depth + 1);
-			this->m_if_branch->dump(os, depth + 1);
-			this->m_else_branch->dump(os, depth + 1);
+		void eliminate_common_subexprs(TempPool& temps)override{
+			this->m_if_branch->eliminate_common_subexprs(temps);
+			this->m_else_branch->eliminate_common_subexprs(temps);
+		}
+
+		// A branch which cannot be taken is skipped.
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		// Only the costlier branch counts.
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_cond->relocate(rel);
+			this->m_if_branch->relocate(rel);
+			this->m_else_branch->relocate(rel);
+		}
+
+		void collect_instr_lists(std::vector<InstrListNode*>& lists)override;
+
+		uint64_t hash(const uint64_t seed)const override{
+			return this->m_else_branch->hash(this->m_if_branch->hash(this->m_cond->hash(BaseNode::hash(seed))));
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			this->m_cond->count_nodes(counts);
+			this->m_if_branch->count_nodes(counts);
+			this->m_else_branch->count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_cond->compile(bc);
+			const uint32_t to_else = bc.emit_jump(OpCode::JUMP_IF_NOT_POS);
+
+			this->m_if_branch->compile(bc);
+			const uint32_t to_end = bc.emit_jump(OpCode::JUMP);
+
+			bc.patch(to_else);
+			this->m_else_branch->compile(bc);
+			bc.patch(to_end);
 		}
 };
 
-class WhileNode: public InstrNode{
+class WhileNode final: public InstrNode{
 	private:
-		std::unique_ptr<BaseNode> m_cond;
-		std::unique_ptr<BaseNode> m_body;
+		NodePtr m_cond;
+		NodePtr m_body;
 
 	public:
 		WhileNode(
@@ -327,12 +964,16 @@ class WhileNode: public InstrNode{
 				BaseNode* const body,
 				const TokenPosition& pos
 			):
-				InstrNode{pos}, m_cond{cond}, m_body{body}{
+				InstrNode{NodeKind::WHILE, pos}, m_cond{cond}, m_body{body}{
 		}
 
 		IntType eval(SymbolTable& sym_table)const override{
-			while(this->m_cond->eval(sym_table) > IntType{})
+			while(eval_node(*this->m_cond, sym_table) > IntType{}){
+				if(!exec_limits.tick())
+					break;
+
 				this->m_body->eval(sym_table);
+			}
 
 			return IntType{};
 		}
@@ -346,52 +987,1560 @@ class WhileNode: public InstrNode{
 			os << '\n';
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
 			BaseNode::dump_placeholder(os, depth);
-			os << "WhileNode[" << this->m_pos << "]:\n";
+			os << "WhileNode[" << ctx.locate(this->m_pos) << "]:\n";
 
-			this->m_cond->dump(os, depth + 1);
-			this->m_body->dump(os, depth + 1);
+			this->m_cond->dump(os, ctx, depth + 1);
+			this->m_body->dump(os, ctx, depth + 1);
 		}
-};
 
-class InstrListNode: public BaseNode{
-	private:
-		std::list<std::unique_ptr<BaseNode>> m_list;
+		BaseNode* clone()const override{
+			return new WhileNode{this->m_cond->clone(), this->m_body->clone(), this->m_pos};
+		}
 
-	public:
-		explicit InstrListNode(const TokenPosition& pos):
-			BaseNode{pos}, m_list{}{
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->m_cond->collect_vars(reads, writes);
+			this->m_body->collect_vars(reads, writes);
 		}
 
-		void add(BaseNode* const node){
-			this->m_list.emplace_back(node);
+		void collect_list_vars(VarSet& lists)const override{
+			this->m_body->collect_list_vars(lists);
 		}
 
-		IntType eval(SymbolTable& sym_table)const override{
-			for(const auto& elem : this->m_list)
-				elem->eval(sym_table);
+		// Only the condition is evaluated in every iteration of an enclosing loop.
+		bool hoist_invariants(LoopInvariants& loop)override;
 
-			return IntType{};
+		BaseNode* optimize_loops(TempPool& temps)override;
+
+		void eliminate_common_subexprs(TempPool& temps)override{
+			this->m_body->eliminate_common_subexprs(temps);
 		}
 
-		void pythonify(std::ostream& os, const uint16_t depth)const override{
-			if(0 == this->m_list.size()){
-				BaseNode::indent_n(os, depth);
-				os << "pass\n";
-			}else{
+		// Iterates the body up to a fixpoint of the state in front of the condition.
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		// Visits the body once, whose evaluations count as often as the loop iterates.
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_cond->relocate(rel);
+			this->m_body->relocate(rel);
+		}
+
+		void collect_instr_lists(std::vector<InstrListNode*>& lists)override;
+
+		uint64_t hash(const uint64_t seed)const override{
+			return this->m_body->hash(this->m_cond->hash(BaseNode::hash(seed)));
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			this->m_cond->count_nodes(counts);
+			this->m_body->count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			const uint32_t head = bc.label();
+			this->m_cond->compile(bc);
+			const uint32_t to_end = bc.emit_jump(OpCode::JUMP_IF_NOT_POS);
+
+			bc.emit_enter(head);
+			this->m_body->compile(bc);
+			bc.emit_loop(head);
+			bc.patch(to_end);
+		}
+};
+
+class InstrListNode final: public BaseNode{
+	private:
+		NodeList m_list;
+
+		// Offset behind the closing parenthesis, 0 if unknown.
+		uint32_t m_end;
+
+	public:
+		explicit InstrListNode(const TokenPosition& pos):
+			BaseNode{NodeKind::INSTR_LIST, pos}, m_list{}, m_end{0}{
+		}
+
+		void add(BaseNode* const node){
+			this->m_list.emplace_back(node);
+		}
+
+		inline const NodeList& instrs()const{
+			return this->m_list;
+		}
+
+		inline NodeList& instrs(){
+			return this->m_list;
+		}
+
+		inline uint32_t end()const{
+			return this->m_end;
+		}
+
+		inline void set_end(const uint32_t end){
+			this->m_end = end;
+		}
+
+		IntType eval(SymbolTable& sym_table)const override{
+			for(const auto& elem : this->m_list){
+				elem->eval(sym_table);
+
+				// Set once a loop ran out of its execution limits.
+				if(exec_limits.stopped())
+					break;
+			}
+
+			return IntType{};
+		}
+
+		void pythonify(std::ostream& os, const uint16_t depth)const override{
+			if(0 == this->m_list.size()){
+				BaseNode::indent_n(os, depth);
+				os << "pass\n";
+			}else{
 				for(const auto& elem : this->m_list)
 					elem->pythonify(os, depth);
 			}
 		}
 
-		void dump(std::ostream& os, const uint16_t depth)const override{
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
 			BaseNode::dump_placeholder(os, depth);
-			os << "InstrListNode[" << this->m_pos << "]:\n";
+			os << "InstrListNode[" << ctx.locate(this->m_pos) << "]:\n";
+
+			for(const auto& elem : this->m_list)
+				elem->dump(os, ctx, depth + 1);
+		}
 
+		BaseNode* clone()const override{
+			InstrListNode* const list = new InstrListNode{this->m_pos};
 			for(const auto& elem : this->m_list)
-				elem->dump(os, depth + 1);
+				list->add(elem->clone());
+
+			list->set_end(this->m_end);
+			return list;
 		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			for(const auto& elem : this->m_list)
+				elem->collect_vars(reads, writes);
+		}
+
+		void collect_list_vars(VarSet& lists)const override{
+			for(const auto& elem : this->m_list)
+				elem->collect_list_vars(lists);
+		}
+
+		// Every element of a loop body is evaluated in every iteration.
+		bool hoist_invariants(LoopInvariants& loop)override{
+			for(auto& elem : this->m_list)
+				elem->hoist_invariants(loop);
+
+			return false;
+		}
+
+		BaseNode* optimize_loops(TempPool& temps)override{
+			for(auto& elem : this->m_list)
+				BaseNode::optimize_loops_of(elem, temps);
+
+			return nullptr;
+		}
+
+		// A straight-line region is a run of assignments, optionally
+		// terminated by an if instruction whose condition still belongs
+		// to the region. The condition of a loop is evaluated repeatedly
+		// and therefore never part of a region.
+		void eliminate_common_subexprs(TempPool& temps)override;
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			this->m_end = rel.apply(this->m_end);
+
+			// An instruction ends in front of the keyword of its successor.
+			for(auto it = this->m_list.begin(); it != this->m_list.end(); ++it){
+				const auto next = std::next(it);
+				if(next != this->m_list.end() && rel.skips((*next)->pos().offset()))
+					continue;
+
+				(*it)->relocate(rel);
+			}
+		}
+
+		// The length separates the instructions of nested lists.
+		uint64_t hash(const uint64_t seed)const override{
+			uint64_t res = BaseNode::hash_bytes(static_cast<uint32_t>(this->m_list.size()), BaseNode::hash(seed));
+			for(const auto& elem : this->m_list)
+				res = elem->hash(res);
+
+			return res;
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			for(const auto& elem : this->m_list)
+				elem->count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			for(const auto& elem : this->m_list){
+				if(NodeKind::ERROR != elem->kind())
+					elem->compile(bc);
+			}
+		}
+
+	private:
+		void eliminate_common_subexprs(NodeList::iterator begin, NodeList::iterator end, TempPool& temps);
 };
 
+// Used for the operands of expressions, most of which are leafs. The node
+// classes are final, hence leafs are evaluated inline and without a virtual
+// call. Inner nodes are still called virtually, their targets are predicted
+// well. Built with VIRTUAL_EVAL, every operand is called virtually, which
+// is the baseline of bench/eval.sh.
+inline IntType eval_node(const BaseNode& node, SymbolTable& sym_table){
+#	ifndef VIRTUAL_EVAL
+		if(NodeKind::INT == node.kind())
+			return static_cast<const IntNode&>(node).value();
+		if(NodeKind::VAR == node.kind())
+			return static_cast<const VarNode&>(node).eval(sym_table);
+#	endif
+
+	return node.eval(sym_table);
+}
+
+inline Value eval_value_node(const BaseNode& node, SymbolTable& sym_table){
+#	ifndef VIRTUAL_EVAL
+		if(NodeKind::INT == node.kind())
+			return Value{static_cast<const IntNode&>(node).value()};
+		if(NodeKind::VAR == node.kind())
+			return static_cast<const VarNode&>(node).eval_value(sym_table);
+#	endif
+
+	return node.eval_value(sym_table);
+}
+
+// Collects the assignments of the temporaries which replace
+// the invariant arithmetic subtrees of a single loop.
+class LoopInvariants{
+	private:
+		VarSet m_assigned;
+		TempPool& m_temps;
+
+		InstrListNode* m_preheader;
+		uint32_t m_hoisted;
+
+	public:
+		LoopInvariants(const BaseNode& loop, TempPool& temps, const TokenPosition& pos):
+			m_assigned{}, m_temps{temps}, m_preheader{new InstrListNode{pos}}, m_hoisted{0}{
+
+			VarSet reads{};
+			loop.collect_vars(reads, this->m_assigned);
+		}
+
+		LoopInvariants(const LoopInvariants&) = delete;
+		LoopInvariants& operator= (const LoopInvariants&) = delete;
+
+		~LoopInvariants(){
+			delete this->m_preheader;
+		}
+
+		inline bool is_assigned(const std::string_view& var_name)const{
+			return this->m_assigned.count(var_name) > 0;
+		}
+
+		inline bool empty()const{
+			return 0 == this->m_hoisted;
+		}
+
+		// Leafs are cheaper to evaluate than the temporary which would replace them.
+		// The temporary holds the value of the node, hence a node which may yield a
+		// list is kept where it is read as an integer ('as_int'), since e.g. the
+		// integer of (mul 5 (list 7 3)) is 10 but its list has the length 2.
+		void hoist(NodePtr& node, const bool as_int){
+			if(NodeKind::INT == node->kind() || NodeKind::VAR == node->kind())
+				return;
+			if(as_int && node->may_yield_list())
+				return;
+
+			const TokenPosition pos = node->pos();
+			const std::string_view temp = this->m_temps.make();
+
+			this->m_preheader->add(new AssignNode{temp, node.release(), pos});
+			node.reset(new VarNode{temp, pos});
+			++this->m_hoisted;
+		}
+
+		// Transfers the ownership of the preheader to the caller.
+		InstrListNode* release_preheader(){
+			InstrListNode* const preheader = this->m_preheader;
+			this->m_preheader = nullptr;
+
+			return preheader;
+		}
+};
+
+inline bool VarNode::hoist_invariants(LoopInvariants& loop){
+	return !loop.is_assigned(this->m_var_name);
+}
+
+inline bool ArithNode::hoist_invariants(LoopInvariants& loop){
+	const bool param1_invariant = this->m_param1->hoist_invariants(loop);
+	const bool param2_invariant = this->m_param2->hoist_invariants(loop);
+
+	// The children of a shared node belong to every parent of the node.
+	if(this->m_shared)
+		return param1_invariant && param2_invariant;
+
+	// Let the parent hoist the largest invariant subtree.
+	if(param1_invariant && param2_invariant)
+		return true;
+
+	// The operands are read as integers if the node is.
+	if(param1_invariant)
+		loop.hoist(this->m_param1, true);
+	if(param2_invariant)
+		loop.hoist(this->m_param2, true);
+
+	return false;
+}
+
+inline bool AssignNode::hoist_invariants(LoopInvariants& loop){
+	if(this->m_value->hoist_invariants(loop))
+		loop.hoist(this->m_value, false);
+
+	return false;
+}
+
+inline bool IfNode::hoist_invariants(LoopInvariants& loop){
+	if(this->m_cond->hoist_invariants(loop))
+		loop.hoist(this->m_cond, true);
+
+	return false;
+}
+
+inline bool WhileNode::hoist_invariants(LoopInvariants& loop){
+	if(this->m_cond->hoist_invariants(loop))
+		loop.hoist(this->m_cond, true);
+
+	return false;
+}
+
+inline void IfNode::collect_instr_lists(std::vector<InstrListNode*>& lists){
+	for(BaseNode* const branch : {this->m_if_branch.get(), this->m_else_branch.get()}){
+		if(NodeKind::INSTR_LIST == branch->kind())
+			lists.push_back(static_cast<InstrListNode*>(branch));
+	}
+}
+
+inline void WhileNode::collect_instr_lists(std::vector<InstrListNode*>& lists){
+	if(NodeKind::INSTR_LIST == this->m_body->kind())
+		lists.push_back(static_cast<InstrListNode*>(this->m_body.get()));
+}
+
+// Local value numbering of a single straight-line region. Structurally
+// identical pure subexpressions get the same number as long as none of
+// their variables is assigned in between, i.e. every assignment gives
+// its variable a fresh number.
+class ValueNumbering{
+	private:
+		struct Temp{
+			NodePtr value;
+			NodeList::iterator insertion_point;
+
+			// The slots of the occurrences, which are empty until finish().
+			std::vector<std::pair<NodePtr*, TokenPosition>> uses;
+		};
+
+		uint32_t m_next;
+
+		std::unordered_map<std::string_view, uint32_t> m_vars;
+		std::unordered_map<IntType, uint32_t> m_consts;
+		std::map<std::tuple<NodeKind, uint32_t, uint32_t>, uint32_t> m_ops;
+
+		std::unordered_map<const BaseNode*, uint32_t> m_numbers;
+		std::vector<uint32_t> m_occurrences;
+
+		// Indexed by value number, in the order of creation.
+		std::unordered_map<uint32_t, size_t> m_temp_idx;
+		std::vector<Temp> m_temps;
+
+		NodeList* m_list;
+		NodeList::iterator m_insertion_point;
+
+	public:
+		explicit ValueNumbering(NodeList& list):
+			m_next{0},
+			m_vars{}, m_consts{}, m_ops{},
+			m_numbers{}, m_occurrences{},
+			m_temp_idx{}, m_temps{},
+			m_list{&list}, m_insertion_point{list.end()}{
+		}
+
+		inline uint32_t unique(){
+			return this->m_next++;
+		}
+
+		uint32_t constant(const IntType value){
+			const auto res = this->m_consts.try_emplace(value, this->m_next);
+			if(res.second)
+				++this->m_next;
+
+			return res.first->second;
+		}
+
+		uint32_t variable(const std::string_view& var_name){
+			const auto res = this->m_vars.try_emplace(var_name, this->m_next);
+			if(res.second)
+				++this->m_next;
+
+			return res.first->second;
+		}
+
+		inline void assign(const std::string_view& var_name){
+			this->m_vars[var_name] = this->unique();
+		}
+
+		uint32_t operation(const BaseNode& node, uint32_t param1, uint32_t param2){
+			if((NodeKind::ADD == node.kind() || NodeKind::MUL == node.kind()) && param2 < param1)
+				std::swap(param1, param2);
+
+			const auto res = this->m_ops.try_emplace({node.kind(), param1, param2}, this->m_next);
+			if(res.second){
+				++this->m_next;
+				this->m_occurrences.resize(this->m_next);
+			}
+
+			const uint32_t number = res.first->second;
+			++this->m_occurrences[number];
+			this->m_numbers.emplace(&node, number);
+
+			return number;
+		}
+
+		// Temporaries computed while rewriting 'instr' are inserted in front of it.
+		inline void set_insertion_point(const NodeList::iterator instr){
+			this->m_insertion_point = instr;
+		}
+
+		void replace(NodePtr& node){
+			const auto number = this->m_numbers.find(node.get());
+			if(number == this->m_numbers.end() || this->m_occurrences[number->second] < 2){
+				node->replace_common_subexprs(*this);
+				return;
+			}
+
+			const TokenPosition pos = node->pos();
+			const auto temp_idx = this->m_temp_idx.find(number->second);
+			if(temp_idx != this->m_temp_idx.end()){
+				node.reset();
+				this->m_temps[temp_idx->second].uses.emplace_back(&node, pos);
+				return;
+			}
+
+			// Nested common subexpressions have to be computed first.
+			node->replace_common_subexprs(*this);
+
+			this->m_temp_idx.emplace(number->second, this->m_temps.size());
+			this->m_temps.push_back(Temp{std::move(node), this->m_insertion_point, {}});
+			this->m_temps.back().uses.emplace_back(&node, pos);
+		}
+
+		// Subexpressions whose other occurrences were all part of a larger
+		// common subexpression end up with a single use and are put back.
+		void finish(TempPool& temps){
+			for(auto& temp : this->m_temps){
+				if(1 == temp.uses.size()){
+					*temp.uses.front().first = std::move(temp.value);
+					continue;
+				}
+
+				const std::string_view temp_name = temps.make();
+				const TokenPosition pos = temp.value->pos();
+
+				this->m_list->emplace(
+					temp.insertion_point,
+					new AssignNode{temp_name, temp.value.release(), pos}
+				);
+
+				for(auto& use : temp.uses)
+					use.first->reset(new VarNode{temp_name, use.second});
+			}
+		}
+};
+
+inline uint32_t BaseNode::number_values(ValueNumbering& vn)const{
+	return vn.unique();
+}
+
+inline uint32_t IntNode::number_values(ValueNumbering& vn)const{
+	return vn.constant(this->m_value);
+}
+
+inline uint32_t VarNode::number_values(ValueNumbering& vn)const{
+	return vn.variable(this->m_var_name);
+}
+
+// Numbers are looked up by node, which is ambiguous for
+// shared nodes, hence they are never replaced.
+inline uint32_t ArithNode::number_values(ValueNumbering& vn)const{
+	if(this->m_shared)
+		return vn.unique();
+
+	const uint32_t param1 = this->m_param1->number_values(vn);
+	const uint32_t param2 = this->m_param2->number_values(vn);
+
+	return vn.operation(*this, param1, param2);
+}
+
+inline void ArithNode::replace_common_subexprs(ValueNumbering& vn){
+	if(this->m_shared)
+		return;
+
+	vn.replace(this->m_param1);
+	vn.replace(this->m_param2);
+}
+
+inline uint32_t AssignNode::number_values(ValueNumbering& vn)const{
+	this->m_value->number_values(vn);
+	vn.assign(this->m_var_name);
+
+	return vn.unique();
+}
+
+inline void AssignNode::replace_common_subexprs(ValueNumbering& vn){
+	vn.replace(this->m_value);
+}
+
+inline uint32_t IfNode::number_values(ValueNumbering& vn)const{
+	this->m_cond->number_values(vn);
+	return vn.unique();
+}
+
+inline void IfNode::replace_common_subexprs(ValueNumbering& vn){
+	vn.replace(this->m_cond);
+}
+
+inline void InstrListNode::eliminate_common_subexprs(TempPool& temps){
+	for(auto& elem : this->m_list)
+		elem->eliminate_common_subexprs(temps);
+
+	auto region_begin = this->m_list.begin();
+	for(auto it = this->m_list.begin(); it != this->m_list.end(); ++it){
+		switch((*it)->kind()){
+			case NodeKind::ASSIGN:
+				break;
+			case NodeKind::IF:
+				this->eliminate_common_subexprs(region_begin, std::next(it), temps);
+				region_begin = std::next(it);
+				break;
+			default:
+				this->eliminate_common_subexprs(region_begin, it, temps);
+				region_begin = std::next(it);
+		}
+	}
+
+	this->eliminate_common_subexprs(region_begin, this->m_list.end(), temps);
+}
+
+inline void InstrListNode::eliminate_common_subexprs(
+		const NodeList::iterator begin,
+		const NodeList::iterator end,
+		TempPool& temps
+	){
+
+	ValueNumbering vn{this->m_list};
+	for(auto it = begin; it != end; ++it)
+		(*it)->number_values(vn);
+
+	for(auto it = begin; it != end; ++it){
+		vn.set_insertion_point(it);
+		(*it)->replace_common_subexprs(vn);
+	}
+
+	vn.finish(temps);
+}
+
+// Inner loops are optimized first. The temporaries are computed once
+// in front of the loop but only if the loop is entered at all, i.e.
+// the loop is rewritten to (if cond ((set __t0 ...) ... (while cond body)) ()).
+// Hence hoisting never evaluates an expression (and thereby inserts its
+// variables into the symbol table) which would not have been evaluated
+// in the first iteration anyway.
+inline BaseNode* WhileNode::optimize_loops(TempPool& temps){
+	BaseNode::optimize_loops_of(this->m_body, temps);
+
+	// The guard has to test the condition before its invariants are hoisted.
+	NodePtr guard{this->m_cond->clone()};
+
+	LoopInvariants loop{*this, temps, this->m_pos};
+	this->hoist_invariants(loop);
+	this->m_body->hoist_invariants(loop);
+
+	if(loop.empty())
+		return nullptr;
+
+	InstrListNode* const preheader = loop.release_preheader();
+	preheader->add(this);
+
+	return new IfNode{
+		guard.release(),
+		preheader,
+		new InstrListNode{this->m_pos},
+		this->m_pos
+	};
+}
+
+// Abstract interpretation of the program with intervals. Every variable
+// starts at 0, loops are iterated up to a fixpoint, which widening bounds
+// to a few iterations, and conditions narrow the ranges of the variables
+// they compare. Facts are only recorded once the state of every enclosing
+// loop is final, i.e. in the last pass over each loop body.
+class RangeAnalysis{
+	public:
+		using State = std::unordered_map<std::string_view, ValueRange>;
+
+	private:
+		static constexpr uint32_t WIDEN_AFTER = 3;
+		static constexpr uint32_t NARROWING_PASSES = 2;
+
+		// The operand of a comparison, 'var' is empty for constants.
+		struct Term{
+			std::string_view var;
+			Interval values;
+		};
+
+		State m_state;
+		bool m_recording;
+
+		// The values every variable may hold, sorted for the report.
+		std::map<std::string_view, ValueRange> m_vars;
+
+		// The operations which may overflow, by offset.
+		std::map<uint32_t, TokenPosition> m_overflows;
+
+		// Whether the list operands of every visit of a multiplication fit in 32 bits.
+		std::unordered_map<MulNode*, bool> m_narrow_muls;
+
+	public:
+		explicit RangeAnalysis(): m_state{}, m_recording{true}, m_vars{}, m_overflows{}, m_narrow_muls{}{
+		}
+
+		inline void run(BaseNode& root){
+			root.analyze_ranges(*this, false);
+		}
+
+		inline bool may_overflow()const{
+			return !this->m_overflows.empty();
+		}
+
+		// Lets every multiplication of lists which cannot overflow in 32 bits use NarrowMulOp.
+		void apply()const;
+
+		void dump(std::ostream& os, LineIndex& lines, const bool with_temps)const{
+			os << "Ranges:\n";
+			for(const auto& entry : this->m_vars){
+				if(!with_temps && is_internal_name(entry.first))
+					continue;
+
+				const ValueRange& range = entry.second;
+				os << ' ' << entry.first << ": ";
+				if(!range.ints.is_empty() || !range.lists)
+					os << range.ints << " (" << range.ints.type_name() << ')';
+				if(!range.ints.is_empty() && range.lists)
+					os << " or ";
+				if(range.lists)
+					os << "list of " << range.elems << " (" << range.elems.type_name() << ')';
+
+				os << '\n';
+			}
+
+			if(this->m_overflows.empty()){
+				os << " overflow: impossible\n";
+				return;
+			}
+
+			os << " overflow: possible at ";
+			bool first = true;
+			for(const auto& overflow : this->m_overflows){
+				os << (first ? "" : "; ") << lines.locate(overflow.second);
+				first = false;
+			}
+			os << '\n';
+		}
+
+		inline const State& state()const{
+			return this->m_state;
+		}
+
+		inline void set_state(State state){
+			this->m_state = std::move(state);
+		}
+
+		inline bool recording()const{
+			return this->m_recording;
+		}
+
+		inline void set_recording(const bool recording){
+			this->m_recording = recording;
+		}
+
+		ValueRange load(const std::string_view& var_name){
+			const auto it = this->m_state.find(var_name);
+			if(it != this->m_state.end())
+				return it->second;
+
+			// Never assigned on any path so far.
+			if(this->m_recording)
+				this->m_vars.try_emplace(var_name, RangeAnalysis::initial());
+
+			return RangeAnalysis::initial();
+		}
+
+		void store(const std::string_view& var_name, const ValueRange& range){
+			this->m_state[var_name] = range;
+			if(!this->m_recording)
+				return;
+
+			const auto res = this->m_vars.try_emplace(var_name, range);
+			if(!res.second)
+				res.first->second = res.first->second.join(range);
+		}
+
+		// Returns the full interval if the operation may overflow.
+		Interval arith(const BaseNode& node, const Interval& a, const Interval& b){
+			Interval res{};
+			if(RangeAnalysis::compute(node.kind(), a, b, res))
+				return res;
+
+			if(this->m_recording)
+				this->m_overflows.emplace(node.pos().offset(), node.pos());
+
+			return Interval::full();
+		}
+
+		void narrow_mul(MulNode& node, const bool narrow){
+			if(!this->m_recording)
+				return;
+
+			const auto res = this->m_narrow_muls.try_emplace(&node, narrow);
+			res.first->second = res.first->second && narrow;
+		}
+
+		// Narrows the state to the values for which 'cond' is positive or, unless
+		// 'holds', not positive. Knows variables and the comparisons of two terms,
+		// i.e. (sub a b) and (add a c), as long as they cannot overflow.
+		void refine(const BaseNode& cond, const bool holds){
+			Term a{};
+			if(this->term(cond, a)){
+				this->constrain(a.var, holds ? Interval{1, INT64_MAX} : Interval{INT64_MIN, 0});
+				return;
+			}
+
+			if(NodeKind::ADD != cond.kind() && NodeKind::SUB != cond.kind())
+				return;
+
+			const ArithNode& arith = static_cast<const ArithNode&>(cond);
+			Term b{};
+			if(!this->term(*arith.param1(), a) || !this->term(*arith.param2(), b))
+				return;
+
+			Interval res{};
+			if(!RangeAnalysis::compute(cond.kind(), a.values, b.values, res))
+				return;
+
+			// a + c > 0 is a > -c.
+			if(NodeKind::ADD == cond.kind()){
+				if(!b.var.empty())
+					std::swap(a, b);
+				if(!b.var.empty() || b.values.lo == INT64_MIN)
+					return;
+
+				b.values = Interval::point(-b.values.lo);
+			}
+
+			// a > b or a <= b, where a bound of +-1 which overflows makes the range empty.
+			IntType bound{};
+			if(holds){
+				this->constrain(a.var, __builtin_add_overflow(b.values.lo, 1, &bound) ? Interval::empty() : Interval{bound, INT64_MAX});
+				this->constrain(b.var, __builtin_sub_overflow(a.values.hi, 1, &bound) ? Interval::empty() : Interval{INT64_MIN, bound});
+			}else{
+				this->constrain(a.var, Interval{INT64_MIN, b.values.hi});
+				this->constrain(b.var, Interval{a.values.lo, INT64_MAX});
+			}
+		}
+
+		// Variables which are not in either state hold their initial value.
+		static State join(const State& a, const State& b){
+			State res{a};
+			for(auto& entry : res){
+				if(0 == b.count(entry.first))
+					entry.second = entry.second.join(RangeAnalysis::initial());
+			}
+
+			for(const auto& entry : b){
+				const auto it = res.find(entry.first);
+				if(it == res.end())
+					res.emplace(entry.first, entry.second.join(RangeAnalysis::initial()));
+				else
+					it->second = it->second.join(entry.second);
+			}
+
+			return res;
+		}
+
+		static State widen(const State& prev, const State& next){
+			State res{next};
+			for(auto& entry : res)
+				entry.second = RangeAnalysis::lookup(prev, entry.first).widen(entry.second);
+
+			return res;
+		}
+
+		static bool includes(const State& a, const State& b){
+			for(const auto& entry : b){
+				if(!RangeAnalysis::lookup(a, entry.first).includes(entry.second))
+					return false;
+			}
+
+			for(const auto& entry : a){
+				if(0 == b.count(entry.first) && !entry.second.includes(RangeAnalysis::initial()))
+					return false;
+			}
+
+			return true;
+		}
+
+		// Returns false if the operation may overflow.
+		static bool compute(const NodeKind kind, const Interval& a, const Interval& b, Interval& res){
+			if(a.is_empty() || b.is_empty()){
+				res = Interval::empty();
+				return true;
+			}
+
+			bool overflow = false;
+			switch(kind){
+				case NodeKind::ADD:
+					overflow = __builtin_add_overflow(a.lo, b.lo, &res.lo) || __builtin_add_overflow(a.hi, b.hi, &res.hi);
+					break;
+				case NodeKind::SUB:
+					overflow = __builtin_sub_overflow(a.lo, b.hi, &res.lo) || __builtin_sub_overflow(a.hi, b.lo, &res.hi);
+					break;
+				default:{
+					res = Interval::empty();
+					for(const IntType x : {a.lo, a.hi}){
+						for(const IntType y : {b.lo, b.hi}){
+							IntType product{};
+							overflow = overflow || __builtin_mul_overflow(x, y, &product);
+							res = res.join(Interval::point(product));
+						}
+					}
+				}
+			}
+
+			return !overflow;
+		}
+
+		static constexpr uint32_t widen_after(){
+			return RangeAnalysis::WIDEN_AFTER;
+		}
+
+		static constexpr uint32_t narrowing_passes(){
+			return RangeAnalysis::NARROWING_PASSES;
+		}
+
+	private:
+		static constexpr ValueRange initial(){
+			return ValueRange::of_int(Interval::point(0));
+		}
+
+		static ValueRange lookup(const State& state, const std::string_view& var_name){
+			const auto it = state.find(var_name);
+			return (it != state.end()) ? it->second : RangeAnalysis::initial();
+		}
+
+		// Only integer variables are narrowed.
+		bool term(const BaseNode& node, Term& res)const{
+			if(NodeKind::INT == node.kind()){
+				res = Term{std::string_view{}, Interval::point(static_cast<const IntNode&>(node).value())};
+				return true;
+			}
+
+			if(NodeKind::VAR != node.kind())
+				return false;
+
+			const std::string_view var_name = static_cast<const VarNode&>(node).var_name();
+			const ValueRange range = RangeAnalysis::lookup(this->m_state, var_name);
+			if(range.lists)
+				return false;
+
+			res = Term{var_name, range.ints};
+			return true;
+		}
+
+		void constrain(const std::string_view& var_name, const Interval& values){
+			if(var_name.empty())
+				return;
+
+			ValueRange range = RangeAnalysis::lookup(this->m_state, var_name);
+			range.ints = range.ints.meet(values);
+			this->m_state[var_name] = range;
+		}
+};
+
+inline void RangeAnalysis::apply()const{
+	for(const auto& entry : this->m_narrow_muls)
+		entry.first->set_narrow(entry.second);
+}
+
+inline ValueRange VarNode::analyze_ranges(RangeAnalysis& ra, const bool as_int){
+	const ValueRange range = ra.load(this->m_var_name);
+	return as_int ? ValueRange::of_int(range.as_int()) : range;
+}
+
+// Lists combine their elements with the elements or the broadcast integer of the other operand.
+inline ValueRange ArithNode::analyze_ranges(RangeAnalysis& ra, const bool as_int){
+	const ValueRange param1 = this->m_param1->analyze_ranges(ra, as_int);
+	const ValueRange param2 = this->m_param2->analyze_ranges(ra, as_int);
+
+	ValueRange res = ValueRange::of_int(ra.arith(*this, param1.ints, param2.ints));
+	if(!param1.lists && !param2.lists)
+		return res;
+
+	const Interval elems1 = param1.elems.join(param1.ints);
+	const Interval elems2 = param2.elems.join(param2.ints);
+
+	res.elems = ra.arith(*this, elems1, elems2);
+	res.lists = true;
+
+	if(NodeKind::MUL == this->m_kind)
+		ra.narrow_mul(static_cast<MulNode&>(*this), elems1.fits<int32_t>() && elems2.fits<int32_t>());
+
+	return res;
+}
+
+inline ValueRange AssignNode::analyze_ranges(RangeAnalysis& ra, const bool /*as_int*/){
+	ra.store(this->m_var_name, this->m_value->analyze_ranges(ra, false));
+	return ValueRange::none();
+}
+
+inline ValueRange IfNode::analyze_ranges(RangeAnalysis& ra, const bool /*as_int*/){
+	const Interval cond = this->m_cond->analyze_ranges(ra, true).ints;
+	if(cond.is_empty())
+		return ValueRange::none();
+
+	const RangeAnalysis::State before = ra.state();
+	RangeAnalysis::State res{};
+	bool reachable = false;
+
+	for(const bool holds : {true, false}){
+		if(holds ? (cond.hi <= 0) : (cond.lo > 0))
+			continue;
+
+		ra.set_state(before);
+		ra.refine(*this->m_cond, holds);
+		(holds ? this->m_if_branch : this->m_else_branch)->analyze_ranges(ra, false);
+
+		res = reachable ? RangeAnalysis::join(res, ra.state()) : ra.state();
+		reachable = true;
+	}
+
+	ra.set_state(std::move(res));
+	return ValueRange::none();
+}
+
+inline ValueRange WhileNode::analyze_ranges(RangeAnalysis& ra, const bool /*as_int*/){
+	const RangeAnalysis::State entry = ra.state();
+	const bool recording = ra.recording();
+
+	// Returns the state at the head of the next iteration.
+	const auto iterate = [&](const RangeAnalysis::State& head){
+		ra.set_state(head);
+		const Interval cond = this->m_cond->analyze_ranges(ra, true).ints;
+		if(cond.hi > 0){
+			ra.refine(*this->m_cond, true);
+			this->m_body->analyze_ranges(ra, false);
+		}
+
+		return RangeAnalysis::join(entry, ra.state());
+	};
+
+	ra.set_recording(false);
+
+	RangeAnalysis::State head = entry;
+	for(uint32_t i = 0; ; ++i){
+		RangeAnalysis::State next = iterate(head);
+		if(RangeAnalysis::includes(head, next))
+			break;
+
+		head = (i < RangeAnalysis::widen_after()) ? std::move(next) : RangeAnalysis::widen(head, next);
+	}
+
+	for(uint32_t i = 0; i < RangeAnalysis::narrowing_passes(); ++i){
+		ra.set_recording(recording && i + 1 == RangeAnalysis::narrowing_passes());
+		head = iterate(head);
+	}
+
+	ra.set_recording(recording);
+	ra.set_state(std::move(head));
+
+	// A loop whose condition always holds only ends by the execution limits.
+	if(this->m_cond->analyze_ranges(ra, true).ints.lo <= 0)
+		ra.refine(*this->m_cond, false);
+
+	return ValueRange::none();
+}
+
+inline ValueRange InstrListNode::analyze_ranges(RangeAnalysis& ra, const bool /*as_int*/){
+	for(const auto& elem : this->m_list)
+		elem->analyze_ranges(ra, false);
+
+	return ValueRange::none();
+}
+
+// Static estimate of the cost of a program, without evaluating it: the nodes
+// by loop nesting depth, the trip count of every loop and, from these, upper
+// bounds of the loop iterations (the steps of --max-steps) and the evaluated
+// nodes. Unlike RangeAnalysis, every node is visited once, hence variables
+// assigned within a loop are unknown there and behind it, except for the
+// counter of a loop whose trip count is derived, see trip_count(). List
+// operations count their elements, the lengths of lists are tracked like
+// integers.
+class CostEstimate{
+	public:
+		using State = std::unordered_map<std::string_view, CostValue>;
+
+		// Whatever differs between the branches of a condition.
+		struct Snapshot{
+			State state;
+			uint64_t evals;
+			uint64_t steps;
+		};
+
+	private:
+		// The operand of a loop condition, 'var' is empty for constants.
+		struct Term{
+			std::string_view var;
+			Interval values;
+		};
+
+		LineIndex* m_lines;
+
+		// The variables which may hold a list at some point.
+		VarSet m_lists;
+
+		State m_state;
+
+		// How often the current node is evaluated, 0 for dead code.
+		uint64_t m_mult;
+		uint32_t m_depth;
+
+		std::vector<uint64_t> m_nodes;
+		std::vector<LoopCost> m_loops;
+
+		uint64_t m_evals;
+		uint64_t m_steps;
+
+	public:
+		explicit CostEstimate(LineIndex& lines):
+			m_lines{&lines}, m_lists{}, m_state{}, m_mult{1}, m_depth{0}, m_nodes{}, m_loops{}, m_evals{0}, m_steps{0}{
+		}
+
+		// Variables which never hold a list are known to be integers where they are unknown otherwise.
+		inline void run(const BaseNode& root){
+			size_t cnt{};
+			do{
+				cnt = this->m_lists.size();
+				root.collect_list_vars(this->m_lists);
+			}while(this->m_lists.size() != cnt);
+
+			root.estimate_cost(*this);
+		}
+
+		// Whether the expression may yield a list if the variables in 'lists' may hold one.
+		static bool may_yield_list(const BaseNode& node, const VarSet& lists){
+			switch(node.kind()){
+				case NodeKind::LIST:
+				case NodeKind::RANGE:
+					return true;
+				case NodeKind::VAR:
+					return lists.count(static_cast<const VarNode&>(node).var_name()) > 0;
+				case NodeKind::ADD:
+				case NodeKind::SUB:
+				case NodeKind::MUL:{
+					const ArithNode& arith = static_cast<const ArithNode&>(node);
+					return CostEstimate::may_yield_list(*arith.param1(), lists) || CostEstimate::may_yield_list(*arith.param2(), lists);
+				}
+				default:
+					return false;
+			}
+		}
+
+		void print_json(std::ostream& os)const;
+
+		// Returns the previous index, positions refer to the code of 'lines' until it is replaced.
+		inline LineIndex* set_lines(LineIndex* const lines){
+			return std::exchange(this->m_lines, lines);
+		}
+
+		inline uint64_t multiplier()const{
+			return this->m_mult;
+		}
+
+		inline void set_multiplier(const uint64_t mult){
+			this->m_mult = mult;
+		}
+
+		inline void visit(){
+			if(this->m_depth >= this->m_nodes.size())
+				this->m_nodes.resize(this->m_depth + 1);
+
+			++this->m_nodes[this->m_depth];
+			this->m_evals = saturating_add(this->m_evals, this->m_mult);
+		}
+
+		// Counts 'n' elements of lists per evaluation.
+		inline void add_elems(const uint64_t n){
+			this->m_evals = saturating_add(this->m_evals, saturating_mul(this->m_mult, n));
+		}
+
+		CostValue load(const std::string_view& var_name)const{
+			return CostEstimate::lookup(this->m_state, var_name);
+		}
+
+		inline void store(const std::string_view& var_name, const CostValue& value){
+			this->m_state[var_name] = value;
+		}
+
+		// Operations which may overflow yield any integer.
+		CostValue arith(const BaseNode& node, const CostValue& a, const CostValue& b){
+			Interval ints{};
+			if(!RangeAnalysis::compute(node.kind(), a.as_int(), b.as_int(), ints))
+				ints = Interval::full();
+
+			if(!a.may_be_list() && !b.may_be_list())
+				return CostValue::of_int(ints);
+
+			const Interval lens = a.lens.join(b.lens);
+			this->add_elems(max_count(lens));
+
+			return CostValue{ints, lens};
+		}
+
+		inline Snapshot snapshot()const{
+			return Snapshot{this->m_state, this->m_evals, this->m_steps};
+		}
+
+		inline void restore(Snapshot snapshot){
+			this->m_state = std::move(snapshot.state);
+			this->m_evals = snapshot.evals;
+			this->m_steps = snapshot.steps;
+		}
+
+		// The costlier branch counts.
+		static Snapshot join(const Snapshot& a, const Snapshot& b){
+			return Snapshot{
+				CostEstimate::join(a.state, b.state),
+				std::max(a.evals, b.evals),
+				std::max(a.steps, b.steps)
+			};
+		}
+
+		inline const State& state()const{
+			return this->m_state;
+		}
+
+		// The loop runs while a > b, where the condition is a variable a (and b
+		// is 0), (sub a b) or (add a c) (and b is -c). Exactly one of a and b has
+		// to be a variable which is assigned in the body, by a single
+		// (set v (add v c)) or (set v (sub v c)) at the top level of the body,
+		// which approaches the other one, i.e. the bound.
+		TripCount trip_count(const BaseNode& cond, const BaseNode& body)const;
+
+		// Records the loop and prepares the state of its body.
+		void enter_loop(const BaseNode& loop, const BaseNode& body, const TripCount& trips){
+			this->m_loops.push_back(LoopCost{this->m_lines->locate(loop.pos()), this->m_depth, trips});
+			this->m_steps = saturating_add(this->m_steps, saturating_mul(this->m_mult, trips.times()));
+			++this->m_depth;
+
+			VarSet reads{};
+			VarSet writes{};
+			body.collect_vars(reads, writes);
+
+			for(const std::string_view& var_name : writes){
+				this->m_state[var_name] = CostValue{
+					Interval::full(),
+					(this->m_lists.count(var_name) > 0) ? Interval{0, INT64_MAX} : Interval::empty()
+				};
+			}
+
+			if(!trips.counter.empty())
+				this->m_state[trips.counter] = CostValue::of_int(trips.values);
+		}
+
+		// The state behind the loop joins its entry (if the loop may not run)
+		// and the end of the body, whose state covers every iteration.
+		void leave_loop(State entry, const TripCount& trips, const uint64_t mult){
+			--this->m_depth;
+			this->m_mult = mult;
+
+			if(TripCount::Kind::BOUNDED == trips.kind && 0 == trips.max){
+				this->m_state = std::move(entry);
+				return;
+			}
+
+			this->m_state = CostEstimate::join(entry, this->m_state);
+			if(trips.exact)
+				this->m_state[trips.counter] = CostValue::of_int(Interval::point(trips.exit));
+		}
+
+	private:
+		static constexpr CostValue initial(){
+			return CostValue::of_int(Interval::point(0));
+		}
+
+		static CostValue lookup(const State& state, const std::string_view& var_name){
+			const auto it = state.find(var_name);
+			return (it != state.end()) ? it->second : CostEstimate::initial();
+		}
+
+		// Variables which are not in either state hold their initial value.
+		static State join(const State& a, const State& b){
+			State res{a};
+			for(auto& entry : res){
+				if(0 == b.count(entry.first))
+					entry.second = entry.second.join(CostEstimate::initial());
+			}
+
+			for(const auto& entry : b){
+				const auto it = res.find(entry.first);
+				if(it == res.end())
+					res.emplace(entry.first, entry.second.join(CostEstimate::initial()));
+				else
+					it->second = it->second.join(entry.second);
+			}
+
+			return res;
+		}
+
+		static inline IntType clamped_add(const IntType a, const IntType b){
+			IntType res{};
+			if(!__builtin_add_overflow(a, b, &res))
+				return res;
+
+			return (b > 0) ? INT64_MAX : INT64_MIN;
+		}
+
+		bool term(const BaseNode& node, Term& res)const{
+			if(NodeKind::INT == node.kind()){
+				res = Term{std::string_view{}, Interval::point(static_cast<const IntNode&>(node).value())};
+				return true;
+			}
+
+			if(NodeKind::VAR != node.kind())
+				return false;
+
+			const std::string_view var_name = static_cast<const VarNode&>(node).var_name();
+			res = Term{var_name, this->load(var_name).as_int()};
+			return true;
+		}
+
+		// Known values are substituted.
+		static std::string term_name(const Term& term){
+			return (term.values.lo == term.values.hi) ? std::to_string(term.values.lo) : std::string{term.var};
+		}
+
+		// Returns false unless 'var' is assigned exactly once, at the top level of 'body'.
+		static bool counter_step(const InstrListNode& body, const std::string_view& var_name, IntType& step){
+			bool found = false;
+			for(const auto& instr : body.instrs()){
+				VarSet reads{};
+				VarSet writes{};
+				instr->collect_vars(reads, writes);
+				if(0 == writes.count(var_name))
+					continue;
+
+				if(found || NodeKind::ASSIGN != instr->kind())
+					return false;
+
+				const AssignNode& assign = static_cast<const AssignNode&>(*instr);
+				if(!CostEstimate::counter_update(*assign.value(), var_name, step))
+					return false;
+
+				found = true;
+			}
+
+			return found;
+		}
+
+		// (add v c), (add c v) or (sub v c).
+		static bool counter_update(const BaseNode& value, const std::string_view& var_name, IntType& step){
+			if(NodeKind::ADD != value.kind() && NodeKind::SUB != value.kind())
+				return false;
+
+			const ArithNode& arith = static_cast<const ArithNode&>(value);
+			const auto is_counter = [&var_name](const BaseNode& node){
+				return NodeKind::VAR == node.kind() && static_cast<const VarNode&>(node).var_name() == var_name;
+			};
+
+			const BaseNode* const param1 = arith.param1();
+			const BaseNode* const param2 = arith.param2();
+
+			if(NodeKind::ADD == value.kind() && NodeKind::INT == param1->kind() && is_counter(*param2)){
+				step = static_cast<const IntNode&>(*param1).value();
+				return true;
+			}
+
+			if(!is_counter(*param1) || NodeKind::INT != param2->kind())
+				return false;
+
+			step = static_cast<const IntNode&>(*param2).value();
+			if(NodeKind::SUB == value.kind()){
+				if(INT64_MIN == step)
+					return false;
+
+				step = -step;
+			}
+
+			return true;
+		}
+};
+
+inline TripCount CostEstimate::trip_count(const BaseNode& cond, const BaseNode& body)const{
+	Term a{};
+	Term b{};
+	if(this->term(cond, a))
+		b = Term{std::string_view{}, Interval::point(0)};
+	else if(NodeKind::ADD == cond.kind() || NodeKind::SUB == cond.kind()){
+		const ArithNode& arith = static_cast<const ArithNode&>(cond);
+		if(!this->term(*arith.param1(), a) || !this->term(*arith.param2(), b))
+			return TripCount::unbounded();
+
+		// a + c > 0 is a > -c.
+		if(NodeKind::ADD == cond.kind()){
+			if(!b.var.empty())
+				std::swap(a, b);
+			if(!b.var.empty() || INT64_MIN == b.values.lo)
+				return TripCount::unbounded();
+
+			b.values = Interval::point(-b.values.lo);
+		}
+	}else
+		return TripCount::unbounded();
+
+	// The condition never holds at the entry.
+	if(a.values.is_empty() || b.values.is_empty() || a.values.hi <= b.values.lo)
+		return TripCount::bounded(0, true);
+
+	const BaseNode& instrs = body.resolve();
+	if(NodeKind::INSTR_LIST != instrs.kind())
+		return TripCount::unbounded();
+
+	VarSet reads{};
+	VarSet writes{};
+	instrs.collect_vars(reads, writes);
+
+	const bool a_counts = !a.var.empty() && writes.count(a.var) > 0;
+	const bool b_counts = !b.var.empty() && writes.count(b.var) > 0;
+	if(a_counts == b_counts)
+		return TripCount::unbounded();
+
+	// a has to decrease or b to increase.
+	IntType step{};
+	if(!CostEstimate::counter_step(static_cast<const InstrListNode&>(instrs), a_counts ? a.var : b.var, step)
+			|| (a_counts ? (step >= 0 || INT64_MIN == step) : (step <= 0)))
+		return TripCount::unbounded();
+
+	const IntType dist = a_counts ? -step : step;
+
+	TripCount res = TripCount::unbounded();
+	res.counter = a_counts ? a.var : b.var;
+	res.step = step;
+
+	// The values before and after the assignment in the body.
+	res.values = a_counts
+		? Interval{CostEstimate::clamped_add(b.values.lo, 1 - dist), a.values.hi}
+		: Interval{b.values.lo, CostEstimate::clamped_add(a.values.hi, dist - 1)};
+
+	if(INT64_MAX == a.values.hi || INT64_MIN == b.values.lo){
+		const bool minus = (b.values != Interval::point(0));
+		const std::string diff = CostEstimate::term_name(a) + (minus ? " - " + CostEstimate::term_name(b) : "");
+
+		res.kind = TripCount::Kind::SYMBOLIC;
+		if(1 == dist)
+			res.expr = diff;
+		else
+			res.expr = "ceil(" + (minus ? '(' + diff + ')' : diff) + " / " + std::to_string(dist) + ')';
+		return res;
+	}
+
+	// Both are within the range of IntType, hence so is their distance as an unsigned integer.
+	const uint64_t diff = static_cast<uint64_t>(a.values.hi) - static_cast<uint64_t>(b.values.lo);
+	const uint64_t d = static_cast<uint64_t>(dist);
+
+	res.kind = TripCount::Kind::BOUNDED;
+	res.max = diff / d + ((0 == diff % d) ? 0 : 1);
+
+	// The counter ends at its start plus the trip count times the step.
+	if(a.values.lo == a.values.hi && b.values.lo == b.values.hi){
+		IntType delta{};
+		const IntType start = a_counts ? a.values.hi : b.values.lo;
+		res.exact = res.max <= static_cast<uint64_t>(INT64_MAX)
+			&& !__builtin_mul_overflow(static_cast<IntType>(res.max), step, &delta)
+			&& !__builtin_add_overflow(start, delta, &res.exit);
+	}
+
+	return res;
+}
+
+inline void CostEstimate::print_json(std::ostream& os)const{
+	const auto print_count = [&os](const uint64_t count){
+		if(UNBOUNDED_COUNT == count)
+			os << "null";
+		else
+			os << count;
+	};
+
+	uint64_t nodes = 0;
+	for(const uint64_t cnt : this->m_nodes)
+		nodes += cnt;
+
+	os << "{\"nodes\":" << nodes << ",\"nodes_by_depth\":[";
+	for(size_t i = 0; i < this->m_nodes.size(); ++i)
+		os << ((0 == i) ? "" : ",") << this->m_nodes[i];
+
+	os << "],\"loops\":[";
+	for(size_t i = 0; i < this->m_loops.size(); ++i){
+		const LoopCost& loop = this->m_loops[i];
+		os << ((0 == i) ? "" : ",") << '{';
+
+		if(!loop.loc.source.empty()){
+			os << "\"source\":\"";
+			for(const char c : loop.loc.source)
+				os << ((c == '"' || c == '\\') ? "\\" : "") << c;
+
+			os << "\",";
+		}
+
+		os << "\"line\":" << loop.loc.line << ",\"col\":" << loop.loc.col
+		   << ",\"depth\":" << loop.depth << ",\"trips\":\"" << loop.trips.kind_name() << '"';
+
+		if(TripCount::Kind::BOUNDED == loop.trips.kind)
+			os << ",\"max_trips\":" << loop.trips.max << ",\"exact\":" << (loop.trips.exact ? "true" : "false");
+		else if(TripCount::Kind::SYMBOLIC == loop.trips.kind)
+			os << ",\"expr\":\"" << loop.trips.expr << '"';
+
+		os << '}';
+	}
+
+	os << "],\"bounded\":" << ((UNBOUNDED_COUNT != this->m_steps && UNBOUNDED_COUNT != this->m_evals) ? "true" : "false")
+	   << ",\"max_steps\":";
+	print_count(this->m_steps);
+
+	os << ",\"max_evals\":";
+	print_count(this->m_evals);
+
+	os << "}\n";
+}
+
+inline void AssignNode::collect_list_vars(VarSet& lists)const{
+	if(CostEstimate::may_yield_list(*this->m_value, lists))
+		lists.insert(this->m_var_name);
+}
+
+inline CostValue BaseNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+	return CostValue::of_int(Interval::full());
+}
+
+inline CostValue IntNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+	return CostValue::of_int(Interval::point(this->m_value));
+}
+
+inline CostValue VarNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+	return ce.load(this->m_var_name);
+}
+
+inline CostValue ArithNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+
+	const CostValue param1 = this->m_param1->estimate_cost(ce);
+	const CostValue param2 = this->m_param2->estimate_cost(ce);
+
+	return ce.arith(*this, param1, param2);
+}
+
+inline CostValue AssignNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+	ce.store(this->m_var_name, this->m_value->estimate_cost(ce));
+
+	return CostValue::none();
+}
+
+// A branch which cannot be taken is visited for the node counts but evaluated 0 times.
+inline CostValue IfNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+
+	const Interval cond = this->m_cond->estimate_cost(ce).as_int();
+	const uint64_t mult = ce.multiplier();
+	const CostEstimate::Snapshot before = ce.snapshot();
+
+	CostEstimate::Snapshot res{};
+	bool reachable = false;
+
+	for(const bool holds : {true, false}){
+		const bool taken = holds ? (cond.hi > 0) : (!cond.is_empty() && cond.lo <= 0);
+
+		ce.restore(before);
+		ce.set_multiplier(taken ? mult : 0);
+		(holds ? this->m_if_branch : this->m_else_branch)->estimate_cost(ce);
+
+		if(taken){
+			res = reachable ? CostEstimate::join(res, ce.snapshot()) : ce.snapshot();
+			reachable = true;
+		}
+	}
+
+	ce.restore(reachable ? std::move(res) : before);
+	ce.set_multiplier(mult);
+
+	return CostValue::none();
+}
+
+inline CostValue WhileNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+
+	const TripCount trips = ce.trip_count(*this->m_cond, *this->m_body);
+	const uint64_t mult = ce.multiplier();
+	CostEstimate::State entry = ce.state();
+
+	ce.enter_loop(*this, *this->m_body, trips);
+
+	// The condition is evaluated once more than the body.
+	ce.set_multiplier(saturating_mul(mult, saturating_add(trips.times(), 1)));
+	this->m_cond->estimate_cost(ce);
+
+	ce.set_multiplier(saturating_mul(mult, trips.times()));
+	this->m_body->estimate_cost(ce);
+
+	ce.leave_loop(std::move(entry), trips, mult);
+	return CostValue::none();
+}
+
+inline CostValue InstrListNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+	for(const auto& elem : this->m_list)
+		elem->estimate_cost(ce);
+
+	return CostValue::none();
+}
+
 #endif	// AST_NODE_HPP
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef ATOMIC_FILE_HPP
+#define ATOMIC_FILE_HPP
+
+#include <filesystem>
+#include <system_error>
+
+#include <atomic>
+#include <string>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Writes 'data' to a temporary file next to 'path', flushes it to the disk and
+// renames it to 'path'. Readers (even in other processes) see either the old or
+// the new content, never a partially written file, even after a crash.
+static bool write_file_atomically(const std::filesystem::path& path, const std::string& data, std::error_code& ec){
+	// Unique among the processes and the threads writing the same file.
+	static std::atomic<uint32_t> tmp_cnt{0};
+
+	std::filesystem::path tmp_path = path;
+	tmp_path += ".tmp" + std::to_string(::getpid()) + '-' + std::to_string(tmp_cnt.fetch_add(1));
+
+	const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(fd < 0){
+		ec = std::error_code{errno, std::generic_category()};
+		return false;
+	}
+
+	size_t written = 0;
+	while(written < data.size()){
+		const ssize_t res = ::write(fd, data.data() + written, data.size() - written);
+		if(res < 0 && EINTR == errno)
+			continue;
+		if(res <= 0)
+			break;
+
+		written += static_cast<size_t>(res);
+	}
+
+	const bool ok = written == data.size() && 0 == ::fsync(fd);
+	ec = ok ? std::error_code{} : std::error_code{errno, std::generic_category()};
+
+	if(0 != ::close(fd) && ok)
+		ec = std::error_code{errno, std::generic_category()};
+
+	if(!ec)
+		std::filesystem::rename(tmp_path, path, ec);
+
+	if(ec){
+		std::error_code remove_ec{};
+		std::filesystem::remove(tmp_path, remove_ec);
+
+		return false;
+	}
+
+	return true;
+}
+
+#endif	// ATOMIC_FILE_HPP
\ No newline at end of file
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Prints the best eval time of RUNS runs for every program in this directory
+# and every given binary, evaluated by the tree walker instead of the VM. The
+# runs of the binaries are interleaved, so they share the state of the machine.
+# `make bench` compares a build with VIRTUAL_EVAL (the baseline) to the default.
+#
+#   arith_const.tl   200k iterations of a depth-9 constant expression
+#   arith_vars.tl    the same with ~30% variable leafs
+#   assign_loops.tl  loops which are bound by the assignments
+
+[ $# -eq 0 ] && set -- ./theoLISP
+RUNS=${RUNS:-10}
+DIR=$(dirname "$0")
+
+printf '%-16s' ''
+for BIN in "$@"; do
+	printf ' %16s' "$(basename "$BIN")"
+done
+printf '\n'
+
+for PROG in "$DIR"/*.tl; do
+	BEST=
+	i=0
+	while [ $i -lt "$RUNS" ]; do
+		NEXT=
+		for BIN in "$@"; do
+			B=${BEST%% *}
+			BEST=${BEST#"$B"}
+			BEST=${BEST# }
+
+			MS=$("$BIN" --tree-walker --stats "$PROG" 2>&1 | sed -n 's/^ *eval: \([0-9.]*\) ms.*/\1/p')
+			if [ -n "$B" ] && awk "BEGIN{exit !($B <= $MS)}"; then
+				MS=$B
+			fi
+			NEXT="$NEXT $MS"
+		done
+
+		BEST=${NEXT# }
+		i=$((i + 1))
+	done
+
+	printf '%-16s' "$(basename "$PROG")"
+	for MS in $BEST; do
+		printf ' %13s ms' "$MS"
+	done
+	printf '\n'
+done
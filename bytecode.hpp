@@ -0,0 +1,272 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <unordered_map>
+#include <array>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <cstdint>
+
+#include "types.hpp"
+#include "util.hpp"
+
+enum class OpCode: uint8_t{
+	PUSH,			// push value
+	LOAD,			// push slots[arg]
+	STORE,			// slots[arg] = pop
+
+	ADD,
+	SUB,
+	MUL,
+
+	JUMP,			// pc = arg
+	JUMP_IF_NOT_POS,	// pc = arg if pop <= 0
+	ENTER,			// start of a loop body, takes a step or stops in front of the loop head at arg
+	LOOP,			// back-edge of a loop: pc = arg
+
+	HALT
+};
+
+static constexpr const char* const op_code_names[] = {
+	"PUSH",
+	"LOAD",
+	"STORE",
+
+	"ADD",
+	"SUB",
+	"MUL",
+
+	"JUMP",
+	"JUMP_IF_NOT_POS",
+	"ENTER",
+	"LOOP",
+
+	"HALT"
+};
+
+static constexpr size_t OP_CODE_CNT = sizeof(op_code_names) / sizeof(*op_code_names);
+
+// Number of instructions per op code.
+using InstrCounts = std::array<uint64_t, OP_CODE_CNT>;
+
+static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+struct Instr{
+	OpCode op;
+	uint32_t arg;
+	IntType value;
+};
+
+// Every variable of the program is mapped to a slot. Instructions leave the
+// stack empty, in particular at every LOOP, hence the state of a program
+// between two iterations consists of the pc and the slots only.
+class Program{
+	private:
+		std::vector<Instr> m_code;
+		std::vector<std::string> m_slot_names;
+		uint32_t m_max_stack;
+
+		// False if the program uses lists.
+		bool m_supported;
+
+		friend class BytecodeCompiler;
+
+	public:
+		explicit Program(): m_code{}, m_slot_names{}, m_max_stack{0}, m_supported{true}{
+		}
+
+		// The code of an unsupported program must not be run.
+		inline bool supported()const{
+			return this->m_supported;
+		}
+
+		inline const std::vector<Instr>& code()const{
+			return this->m_code;
+		}
+
+		inline const std::vector<std::string>& slot_names()const{
+			return this->m_slot_names;
+		}
+
+		inline uint32_t max_stack()const{
+			return this->m_max_stack;
+		}
+
+		// Returns NO_SLOT if the program does not use the variable.
+		uint32_t find_slot(const std::string_view& name)const{
+			for(uint32_t slot = 0; slot < this->m_slot_names.size(); ++slot){
+				if(this->m_slot_names[slot] == name)
+					return slot;
+			}
+
+			return NO_SLOT;
+		}
+
+		void count_instrs(InstrCounts& counts)const{
+			for(const Instr& instr : this->m_code)
+				++counts[static_cast<uint8_t>(instr.op)];
+		}
+
+		// Identifies the program, e.g. within a checkpoint.
+		uint64_t hash()const{
+			uint64_t res = FNV_OFFSET_BASIS;
+			for(const Instr& instr : this->m_code){
+				res = fnv1a(std::string_view{reinterpret_cast<const char*>(&instr.op), sizeof(instr.op)}, res);
+				res = fnv1a(std::string_view{reinterpret_cast<const char*>(&instr.arg), sizeof(instr.arg)}, res);
+				res = fnv1a(std::string_view{reinterpret_cast<const char*>(&instr.value), sizeof(instr.value)}, res);
+			}
+
+			for(const std::string& name : this->m_slot_names)
+				res = fnv1a(name, fnv1a(std::string_view{"\0", 1}, res));
+
+			return res;
+		}
+};
+
+// Emits the instructions of the nodes, see BaseNode::compile().
+class BytecodeCompiler{
+	private:
+		Program m_program;
+		std::unordered_map<std::string_view, uint32_t> m_slots;
+
+		// The names of spliced slots, which do not refer to the source code.
+		std::deque<std::string> m_spliced_names;
+
+		uint32_t m_stack;
+
+	public:
+		explicit BytecodeCompiler(): m_program{}, m_slots{}, m_spliced_names{}, m_stack{0}{
+		}
+
+		inline void emit_push(const IntType value){
+			this->emit(OpCode::PUSH, 0, value);
+			this->push();
+		}
+
+		inline void emit_load(const std::string_view& name){
+			this->emit(OpCode::LOAD, this->slot(name));
+			this->push();
+		}
+
+		inline void emit_store(const std::string_view& name){
+			this->emit(OpCode::STORE, this->slot(name));
+			--this->m_stack;
+		}
+
+		// Consumes two operands and produces one.
+		inline void emit_arith(const OpCode op){
+			this->emit(op);
+			--this->m_stack;
+		}
+
+		// Returns the index of the jump for patch().
+		inline uint32_t emit_jump(const OpCode op){
+			if(OpCode::JUMP_IF_NOT_POS == op)
+				--this->m_stack;
+
+			return this->emit(op);
+		}
+
+		inline void mark_unsupported(){
+			this->m_program.m_supported = false;
+		}
+
+		inline void emit_enter(const uint32_t head){
+			this->emit(OpCode::ENTER, head);
+		}
+
+		inline void emit_loop(const uint32_t target){
+			this->emit(OpCode::LOOP, target);
+		}
+
+		// Appends the code of another program as if it was an instruction, i.e.
+		// its jumps and slots are relocated and its final HALT is dropped.
+		void splice(
+				const Instr* const code,
+				const uint32_t size,
+				const std::vector<std::string_view>& slot_names,
+				const uint32_t max_stack
+			){
+
+			std::vector<uint32_t> slots{};
+			slots.reserve(slot_names.size());
+			for(const std::string_view& name : slot_names){
+				if(0 == this->m_slots.count(name))
+					this->slot(this->m_spliced_names.emplace_back(name));
+
+				slots.push_back(this->m_slots.find(name)->second);
+			}
+
+			// Room for the code which follows, e.g. HALT, as growing copies
+			// the whole code. Capacity which is never used is never touched.
+			const uint32_t base = this->label();
+			this->m_program.m_code.reserve(2 * (size_t{base} + size));
+			this->m_program.m_code.insert(this->m_program.m_code.end(), code, code + size - 1);
+
+			Instr* const spliced = this->m_program.m_code.data() + base;
+			for(uint32_t i = 0; i + 1 < size; ++i){
+				Instr& instr = spliced[i];
+				switch(instr.op){
+					case OpCode::LOAD:
+					case OpCode::STORE:
+						instr.arg = slots[instr.arg];
+						break;
+					case OpCode::JUMP:
+					case OpCode::JUMP_IF_NOT_POS:
+					case OpCode::ENTER:
+					case OpCode::LOOP:
+						instr.arg += base;
+						break;
+					default:
+						break;
+				}
+			}
+
+			this->m_program.m_max_stack = std::max(this->m_program.m_max_stack, this->m_stack + max_stack);
+		}
+
+		// The jump continues behind the last emitted instruction.
+		inline void patch(const uint32_t jump){
+			this->m_program.m_code[jump].arg = this->label();
+		}
+
+		inline uint32_t label()const{
+			return static_cast<uint32_t>(this->m_program.m_code.size());
+		}
+
+		Program finish(){
+			this->emit(OpCode::HALT);
+			return std::move(this->m_program);
+		}
+
+	private:
+		inline uint32_t emit(const OpCode op, const uint32_t arg = 0, const IntType value = IntType{}){
+			this->m_program.m_code.push_back(Instr{op, arg, value});
+			return this->label() - 1;
+		}
+
+		inline void push(){
+			if(++this->m_stack > this->m_program.m_max_stack)
+				this->m_program.m_max_stack = this->m_stack;
+		}
+
+		uint32_t slot(const std::string_view& name){
+			const auto res = this->m_slots.find(name);
+			if(res != this->m_slots.end())
+				return res->second;
+
+			const uint32_t slot = static_cast<uint32_t>(this->m_program.m_slot_names.size());
+			this->m_program.m_slot_names.emplace_back(name);
+			this->m_slots.emplace(name, slot);
+
+			return slot;
+		}
+};
+
+#endif	// BYTECODE_HPP
\ No newline at end of file
@@ -0,0 +1,335 @@
+#ifndef BYTECODE_PARSER_HPP
+#define BYTECODE_PARSER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <sstream>
+#include <iostream>
+
+#include <cstdlib>
+#include <cstdint>
+
+#include "token.hpp"
+#include "lexer.hpp"
+#include "token_pipe.hpp"
+#include "bytecode.hpp"
+#include "list_node.hpp"
+#include "unit.hpp"
+#include "compiled_unit.hpp"
+#include "util.hpp"
+
+// Compiles the program while it is parsed, i.e. without building the AST,
+// which takes longer than running most programs once. Follows the grammar
+// of Parser and emits the same code as BaseNode::compile(). Syntax errors
+// are reported like by Parser and exit the process, there is no recovery.
+// Imported units are compiled once and spliced in, see CompiledUnit.
+class BytecodeParser{
+	private:
+		const std::string& m_code;
+
+		Token m_token;
+
+		// Invalid chars are reported once the program turns out to be supported,
+		// otherwise Parser lexes the code once more and reports them itself.
+		std::ostringstream m_lex_errors;
+		Lexer m_lexer;
+
+		// Tokens are read from the pipe instead of the lexer unless it is nullptr.
+		std::unique_ptr<TokenPipe> m_pipe;
+
+		BytecodeCompiler m_bc;
+
+		// Set if the program uses lists, which the VM does not know.
+		bool m_unsupported;
+
+		ImportChain m_chain;
+
+		// Every unit spliced in so far, directly or not.
+		std::vector<UnitDependency> m_deps;
+
+	public:
+		explicit BytecodeParser(const std::string& code):
+			m_code{code},
+			m_token{},
+			m_lex_errors{},
+			m_lexer{code, 0, static_cast<uint32_t>(code.size()), &m_lex_errors},
+			m_pipe{},
+			m_bc{},
+			m_unsupported{false},
+			m_chain{},
+			m_deps{}{
+		}
+
+		BytecodeParser(const Unit& unit, ImportChain chain):
+			BytecodeParser{unit.code}{
+
+			this->m_chain = std::move(chain);
+			this->m_lexer.lines().set_source(unit.path);
+		}
+
+		// Counts and times the tokens, see --stats.
+		inline void record_lexing(LexStats* const stats){
+			this->m_lexer.record(stats);
+		}
+
+		// Lexes the code on a thread of its own, see TokenPipe.
+		inline void lex_concurrently(){
+			this->m_pipe = std::make_unique<TokenPipe>(this->m_code, this->m_lexer);
+		}
+
+		// Returns false if the program has to be parsed by Parser instead.
+		bool parse(Program& program){
+			this->read_next_token();
+			this->parse_instr_list();
+			if(this->m_unsupported)
+				return false;
+
+			this->expect(TokenType::CONTR_EOF);
+			this->report_lex_errors();
+
+			program = this->m_bc.finish();
+			return true;
+		}
+
+	private:
+		// instr_list ::= '(' {instr} ')';
+		void parse_instr_list(){
+			this->expect_and_read(TokenType::L_PAR);
+
+			while(this->m_token != TokenType::R_PAR && this->m_token != TokenType::CONTR_EOF && !this->m_unsupported)
+				this->parse_instr();
+
+			this->expect_and_read(TokenType::R_PAR);
+		}
+
+		// instr ::= '(' (assign | cond | loop | import) ')';
+		void parse_instr(){
+			this->expect_and_read(TokenType::L_PAR);
+			switch(this->m_token.type()){
+				case TokenType::SET:
+					this->parse_assign();
+					break;
+				case TokenType::IF:
+					this->parse_cond();
+					break;
+				case TokenType::WHILE:
+					this->parse_loop();
+					break;
+				case TokenType::IDENT:
+					if(IMPORT_SV == this->m_token.value()){
+						this->parse_import();
+						break;
+					}
+					[[fallthrough]];
+				default:
+					this->expect(
+						TokenType::SET,
+						TokenType::IF,
+						TokenType::WHILE
+					);
+			}
+
+			this->expect_and_read(TokenType::R_PAR);
+		}
+
+		// assign ::= 'set' ident exp;
+		void parse_assign(){
+			this->read_next_token();
+
+			this->expect(TokenType::IDENT);
+			const std::string_view var_name = this->m_token.value();
+			this->read_next_token();
+
+			this->parse_exp();
+			this->m_bc.emit_store(var_name);
+		}
+
+		// cond ::= 'if' exp instr_list instrs_list;
+		void parse_cond(){
+			this->read_next_token();
+
+			this->parse_exp();
+			const uint32_t to_else = this->m_bc.emit_jump(OpCode::JUMP_IF_NOT_POS);
+
+			this->parse_instr_list();
+			const uint32_t to_end = this->m_bc.emit_jump(OpCode::JUMP);
+
+			this->m_bc.patch(to_else);
+			this->parse_instr_list();
+			this->m_bc.patch(to_end);
+		}
+
+		// loop ::= 'while' exp instr_list;
+		void parse_loop(){
+			this->read_next_token();
+
+			const uint32_t head = this->m_bc.label();
+			this->parse_exp();
+			const uint32_t to_end = this->m_bc.emit_jump(OpCode::JUMP_IF_NOT_POS);
+
+			this->m_bc.emit_enter(head);
+			this->parse_instr_list();
+			this->m_bc.emit_loop(head);
+			this->m_bc.patch(to_end);
+		}
+
+		// import ::= 'import' ident;
+		void parse_import(){
+			this->read_next_token();
+			this->expect(TokenType::IDENT);
+			if(this->m_unsupported)
+				return;
+
+			const std::shared_ptr<const Unit> unit = Unit::load(this->m_token.value(), std::cerr);
+			ImportChain chain{this->m_chain};
+			if(!unit || !chain.enter(*unit, std::cerr)){
+				this->report_lex_errors();
+				std::exit(-1);
+			}
+
+			CompiledUnit compiled{};
+			if(compiled.load(*unit)){
+				compiled.splice_into(this->m_bc);
+				this->add_deps(*unit, compiled.deps());
+			}else{
+				BytecodeParser parser{*unit, std::move(chain)};
+
+				// The lexer thread of the importer records concurrently.
+				LexStats* const stats = this->m_lexer.stats();
+				if(stats && !stats->concurrent)
+					parser.record_lexing(stats);
+
+				Program program{};
+				if(!parser.parse(program)){
+					this->m_unsupported = true;
+					return;
+				}
+
+				CompiledUnit::store(*unit, program, parser.m_deps, std::cerr);
+
+				const std::vector<std::string_view> slot_names{program.slot_names().begin(), program.slot_names().end()};
+				this->m_bc.splice(program.code().data(), static_cast<uint32_t>(program.code().size()), slot_names, program.max_stack());
+				this->add_deps(*unit, parser.m_deps);
+			}
+
+			this->read_next_token();
+		}
+
+		// A unit which is imported several times is listed once.
+		void add_deps(const Unit& unit, const std::vector<UnitDependency>& deps){
+			const auto add = [this](const UnitDependency& dep){
+				const auto known = std::find_if(this->m_deps.begin(), this->m_deps.end(), [&dep](const UnitDependency& other){
+					return other.name == dep.name;
+				});
+
+				if(known == this->m_deps.end())
+					this->m_deps.push_back(dep);
+			};
+
+			add(UnitDependency{unit.name, unit.hash});
+			for(const UnitDependency& dep : deps)
+				add(dep);
+		}
+
+		// exp ::= integer | ident | '(' arith_exp ')';
+		void parse_exp(){
+			switch(this->m_token.type()){
+				case TokenType::INTEGER:
+					this->m_bc.emit_push(sv_to_int(this->m_token.value()));
+					this->read_next_token();
+					break;
+				case TokenType::IDENT:
+					this->m_bc.emit_load(this->m_token.value());
+					this->read_next_token();
+					break;
+				case TokenType::L_PAR:
+					this->read_next_token();
+					this->parse_arith_exp();
+					this->expect_and_read(TokenType::R_PAR);
+					break;
+				default:
+					this->expect(
+						TokenType::INTEGER,
+						TokenType::IDENT,
+						TokenType::L_PAR
+					);
+			}
+		}
+
+		// arith_exp ::= ('add' | 'sub' | 'mul') exp exp | list_exp;
+		void parse_arith_exp(){
+			if(this->m_token == TokenType::IDENT && list_op_table.count(this->m_token.value()) > 0){
+				this->m_unsupported = true;
+				return;
+			}
+
+			const TokenType arith_type = this->m_token.type();
+			this->expect_and_read(TokenType::ADD, TokenType::SUB, TokenType::MUL);
+
+			this->parse_exp();
+			this->parse_exp();
+
+			if(this->m_unsupported)
+				return;
+
+			switch(arith_type){
+				case TokenType::ADD:
+					this->m_bc.emit_arith(OpCode::ADD);
+					break;
+				case TokenType::SUB:
+					this->m_bc.emit_arith(OpCode::SUB);
+					break;
+				default:
+					this->m_bc.emit_arith(OpCode::MUL);
+			}
+		}
+
+		// Unlike Parser::expect(), a mismatch always exits.
+		template <typename... T>
+		void expect(const T... tt)const{
+			static_assert(sizeof...(T) > 0);
+
+			if(this->m_unsupported || ((this->m_token == tt) || ...))
+				return;
+
+			std::ostringstream oss{};
+			oss << "error[parser, " << this->m_lexer.lines().locate(this->m_token.pos()) << "]: "
+				<< "Invalid token " << this->m_token.name()
+				<< " (";
+
+			print_list(oss, token_type_name(tt)...);
+			oss << " expected).\n";
+
+			this->report_lex_errors();
+			std::cerr << oss.str();
+			std::exit(-1);
+		}
+
+		template <typename... T>
+		inline void expect_and_read(const T... tt){
+			this->expect(tt...);
+			this->read_next_token();
+		}
+
+		// Lexer errors precede the syntax error they may have caused.
+		void report_lex_errors()const{
+			std::cerr << this->m_lex_errors.str();
+		}
+
+		// Once the program is unsupported, the rest of it is left to Parser.
+		inline void read_next_token(){
+			if(this->m_unsupported)
+				return;
+
+			if(this->m_pipe)
+				this->m_pipe->read_next_token(this->m_token);
+			else
+				this->m_lexer.read_next_token(this->m_token);
+		}
+};
+
+#endif	// BYTECODE_PARSER_HPP
\ No newline at end of file
@@ -0,0 +1,191 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <filesystem>
+#include <system_error>
+
+#include <atomic>
+#include <chrono>
+
+#include <string>
+#include <string_view>
+
+#include <fstream>
+#include <sstream>
+#include <ostream>
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+#include "vm.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "exec_limits.hpp"
+#include "atomic_file.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+// A snapshot of the VM in front of a loop head:
+//
+//   theoLISP-checkpoint-1 <program hash>
+//   <pc> <slot count>
+//   <name> <value>		(for every accessed slot)
+class Checkpoint{
+	private:
+		static constexpr std::string_view MAGIC_SV{"theoLISP-checkpoint-1"};
+
+	public:
+		static bool save(const std::string& path, const Program& program, const VM& vm, std::error_code& ec){
+			const VM::SlotValues values = vm.slot_values();
+
+			std::ostringstream oss{};
+			oss << MAGIC_SV << ' ' << to_hex(program.hash()) << '\n'
+				<< vm.pc() << ' ' << values.size() << '\n';
+
+			for(const auto& value : values)
+				oss << value.first << ' ' << value.second << '\n';
+
+			return write_file_atomically(path, oss.str(), ec);
+		}
+
+		static bool load(const std::string& path, const Program& program, VM& vm, std::ostream& err){
+			std::ifstream file{path, std::ios::binary};
+			if(!file){
+				err << "error: Unable to read the checkpoint \'" << path << "\'.\n";
+				return false;
+			}
+
+			std::string magic{};
+			std::string hash{};
+			uint32_t pc{};
+			size_t value_cnt{};
+			if(!(file >> magic >> hash >> pc >> value_cnt) || MAGIC_SV != magic){
+				err << "error: Invalid checkpoint \'" << path << "\'.\n";
+				return false;
+			}
+
+			if(to_hex(program.hash()) != hash){
+				err << "error: The checkpoint \'" << path << "\' belongs to a different program"
+					<< " (or the same program with different options).\n";
+				return false;
+			}
+
+			VM::SlotValues values{};
+			values.reserve(value_cnt);
+
+			std::string name{};
+			IntType value{};
+			while(values.size() < value_cnt && file >> name >> value)
+				values.emplace_back(std::move(name), value);
+
+			if(values.size() != value_cnt || !vm.restore(pc, values)){
+				err << "error: Invalid checkpoint \'" << path << "\'.\n";
+				return false;
+			}
+
+			return true;
+		}
+};
+
+// Stops the evaluation on SIGINT and SIGTERM instead of terminating the
+// process, so the state of the VM can be saved before exiting.
+class InterruptGuard{
+	private:
+		static inline std::atomic<ExecBudget*> active_budget{nullptr};
+
+		struct sigaction m_prev_int;
+		struct sigaction m_prev_term;
+
+	public:
+		explicit InterruptGuard(ExecBudget* const budget): m_prev_int{}, m_prev_term{}{
+			InterruptGuard::active_budget.store(budget);
+
+			struct sigaction action{};
+			action.sa_handler = &InterruptGuard::handle;
+			sigemptyset(&action.sa_mask);
+
+			::sigaction(SIGINT, &action, &this->m_prev_int);
+			::sigaction(SIGTERM, &action, &this->m_prev_term);
+		}
+
+		InterruptGuard(const InterruptGuard&) = delete;
+		InterruptGuard& operator= (const InterruptGuard&) = delete;
+
+		~InterruptGuard(){
+			::sigaction(SIGINT, &this->m_prev_int, nullptr);
+			::sigaction(SIGTERM, &this->m_prev_term, nullptr);
+
+			InterruptGuard::active_budget.store(nullptr);
+		}
+
+	private:
+		// Only lock-free atomics are used, i.e. async-signal-safe.
+		static void handle(const int /*signal*/){
+			if(ExecBudget* const budget = InterruptGuard::active_budget.load())
+				budget->cancel(LimitType::INTERRUPTED);
+		}
+};
+
+// Evaluates the program on the VM instead of the AST. Unless empty, the state is
+// restored from 'resume_path' first and saved to 'checkpoint_path' every
+// 'interval_s' seconds as well as when an execution limit is exceeded or the
+// process is interrupted. Returns false if the checkpoint cannot be resumed.
+static bool eval_resumable(
+		const Program& program,
+		SymbolTable& sym_table,
+		const std::string& checkpoint_path,
+		const uint32_t interval_s,
+		const std::string& resume_path,
+		std::ostream& err
+	){
+
+	if(!program.supported()){
+		err << "error: Programs using lists cannot be evaluated on the VM (--checkpoint, --resume).\n";
+		return false;
+	}
+
+	VM vm{program};
+	if(!resume_path.empty() && !Checkpoint::load(resume_path, program, vm, err))
+		return false;
+
+	bool done{};
+	if(checkpoint_path.empty())
+		done = vm.run();
+	else{
+		const InterruptGuard interrupt_guard{exec_limits.budget()};
+
+		const auto interval = std::chrono::seconds{interval_s};
+		auto next = std::chrono::steady_clock::now() + interval;
+		bool reported = false;
+
+		const auto save = [&](const VM& state){
+			std::error_code ec{};
+			if(Checkpoint::save(checkpoint_path, program, state, ec))
+				return true;
+
+			if(!reported){
+				err << "warning: Unable to write the checkpoint \'" << checkpoint_path << "\' (" << ec.message() << ").\n";
+				reported = true;
+			}
+
+			return false;
+		};
+
+		done = vm.run([&](const VM& state){
+			const auto now = std::chrono::steady_clock::now();
+			if(now >= next){
+				save(state);
+				next = now + interval;
+			}
+		});
+
+		if(!done && save(vm))
+			err << "note: Checkpoint written to \'" << checkpoint_path << "\', continue with --resume.\n";
+	}
+
+	vm.store(sym_table);
+	return true;
+}
+
+#endif	// CHECKPOINT_HPP
\ No newline at end of file
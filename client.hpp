@@ -0,0 +1,60 @@
+#ifndef CLIENT_HPP
+#define CLIENT_HPP
+
+#include <string>
+
+#include <iostream>
+
+#include "unix_socket.hpp"
+
+#include "args.hpp"
+
+// Sends the program (or the id of a program cached by the server) to the
+// server and prints the response like the interpreter would print it.
+// The id of the program is printed to stderr for later requests.
+static bool run_client(const std::string& code){
+	UnixSocket server = UnixSocket::connect(args.connect_socket, std::cerr);
+	if(!server.valid())
+		return false;
+
+	Message request{};
+	if(!args.program_id.empty())
+		request.set("program", args.program_id);
+	else
+		request.set_body(code);
+
+	request.set("optimize", args.optimize ? "1" : "0");
+	request.set("dump-ast", args.dump_ast ? "1" : "0");
+	request.set("dump-sym", args.dump_sym_table ? "1" : "0");
+	request.set("dump-temps", args.dump_temps ? "1" : "0");
+	request.set("dump-ranges", args.dump_ranges ? "1" : "0");
+	request.set("pythonify", args.pythonify ? "1" : "0");
+	request.set("estimate-cost", args.estimate_cost ? "1" : "0");
+
+	if(1 != args.priority)
+		request.set("priority", std::to_string(args.priority));
+	if(0 != args.max_steps)
+		request.set("max-steps", std::to_string(args.max_steps));
+	if(0 != args.timeout_ms)
+		request.set("timeout", std::to_string(args.timeout_ms));
+
+	Message response{};
+	if(!server.write(request) || !server.read(response)){
+		std::cerr << "error: Invalid response of the server \'" << args.connect_socket << "\'.\n";
+		return false;
+	}
+
+	const std::string program = response.get("program");
+	if(!program.empty())
+		std::clog << "program: " << program << '\n';
+
+	if("ok" == response.get("status")){
+		std::cout << response.body();
+		return true;
+	}else{
+		std::cerr << response.body();
+		return false;
+	}
+}
+
+#endif	// CLIENT_HPP
\ No newline at end of file
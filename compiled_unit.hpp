@@ -0,0 +1,260 @@
+#ifndef COMPILED_UNIT_HPP
+#define COMPILED_UNIT_HPP
+
+#include <filesystem>
+#include <system_error>
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include <sstream>
+#include <ostream>
+
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#include "unit.hpp"
+#include "bytecode.hpp"
+#include "mapped_file.hpp"
+#include "atomic_file.hpp"
+#include "util.hpp"
+
+// A unit imported by a compiled unit, directly or not.
+struct UnitDependency{
+	std::string name;
+	uint64_t hash;
+};
+
+// The bytecode of a unit, stored as .tlcache/<name>.tlc within the import
+// directory. The code of the units it imports is part of it, hence it is
+// valid as long as the content hashes of the unit and of these units match.
+// The file is mapped and its code spliced into the program without parsing
+// or copying it first. Like ResultCache, the cache is best effort: a file
+// which cannot be read is a miss and one which cannot be written is only
+// reported.
+//
+// Layout: Header, Instr[code_size], the hashes of the dependencies, then the
+// names of the slots and the names of the dependencies, each followed by '\0'.
+class CompiledUnit{
+	private:
+		static constexpr char MAGIC[8] = {'t', 'l', 'u', 'n', 'i', 't', '0', '2'};
+
+		struct Header{
+			char magic[8];
+			uint32_t instr_size;	// the layout of Instr
+			uint32_t code_size;
+			uint64_t hash;
+			uint32_t max_stack;
+			uint32_t slot_cnt;
+			uint32_t dep_cnt;
+			uint32_t names_size;
+		};
+
+		static_assert(sizeof(Header) % alignof(Instr) == 0);
+
+		MappedFile m_file;
+
+		const Instr* m_code;
+		uint32_t m_code_size;
+		uint32_t m_max_stack;
+
+		std::vector<std::string_view> m_slot_names;
+		std::vector<UnitDependency> m_deps;
+
+	public:
+		explicit CompiledUnit(): m_file{}, m_code{nullptr}, m_code_size{0}, m_max_stack{0}, m_slot_names{}, m_deps{}{
+		}
+
+		// Returns false if the unit has not been compiled or has changed since.
+		bool load(const Unit& unit){
+			std::ostringstream ignored{};
+			if(!MappedFile::open(CompiledUnit::path_of(unit).string(), this->m_file, ignored))
+				return false;
+
+			const std::string_view data = this->m_file.view();
+
+			Header header{};
+			if(data.size() < sizeof(Header))
+				return false;
+
+			std::memcpy(&header, data.data(), sizeof(Header));
+			if(0 != std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) || sizeof(Instr) != header.instr_size || unit.hash != header.hash)
+				return false;
+
+			const uint64_t code_bytes = uint64_t{header.code_size} * sizeof(Instr);
+			const uint64_t hash_bytes = uint64_t{header.dep_cnt} * sizeof(uint64_t);
+			if(0 == header.code_size || data.size() != sizeof(Header) + code_bytes + hash_bytes + header.names_size)
+				return false;
+
+			this->m_code = reinterpret_cast<const Instr*>(data.data() + sizeof(Header));
+			this->m_code_size = header.code_size;
+			this->m_max_stack = header.max_stack;
+
+			std::string_view names = data.substr(sizeof(Header) + code_bytes + hash_bytes);
+			for(uint32_t i = 0; i < header.slot_cnt + header.dep_cnt; ++i){
+				const size_t end = names.find('\0');
+				if(std::string_view::npos == end)
+					return false;
+
+				if(i < header.slot_cnt)
+					this->m_slot_names.push_back(names.substr(0, end));
+				else{
+					uint64_t hash{};
+					std::memcpy(&hash, data.data() + sizeof(Header) + code_bytes + (i - header.slot_cnt) * sizeof(uint64_t), sizeof(hash));
+					this->m_deps.push_back(UnitDependency{std::string{names.substr(0, end)}, hash});
+				}
+
+				names.remove_prefix(end + 1);
+			}
+
+			return this->valid_code() && this->deps_unchanged();
+		}
+
+		static void store(const Unit& unit, const Program& program, const std::vector<UnitDependency>& deps, std::ostream& err){
+			Header header{};
+			std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.instr_size = sizeof(Instr);
+			header.code_size = static_cast<uint32_t>(program.code().size());
+			header.hash = unit.hash;
+			header.max_stack = program.max_stack();
+			header.slot_cnt = static_cast<uint32_t>(program.slot_names().size());
+			header.dep_cnt = static_cast<uint32_t>(deps.size());
+
+			std::string names{};
+			for(const std::string& name : program.slot_names())
+				names.append(name).push_back('\0');
+			for(const UnitDependency& dep : deps)
+				names.append(dep.name).push_back('\0');
+
+			header.names_size = static_cast<uint32_t>(names.size());
+
+			std::string data{};
+			data.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+			for(const Instr& instr : program.code()){
+				// Zeroes the padding, i.e. the file only depends on the program.
+				Instr stored{};
+				std::memset(&stored, 0, sizeof(Instr));
+				stored.op = instr.op;
+				stored.arg = instr.arg;
+				stored.value = instr.value;
+
+				data.append(reinterpret_cast<const char*>(&stored), sizeof(Instr));
+			}
+			for(const UnitDependency& dep : deps)
+				data.append(reinterpret_cast<const char*>(&dep.hash), sizeof(dep.hash));
+			data.append(names);
+
+			const std::filesystem::path path = CompiledUnit::path_of(unit);
+
+			std::error_code ec{};
+			std::filesystem::create_directories(path.parent_path(), ec);
+			if(ec || !write_file_atomically(path, data, ec))
+				err << "warning: Unable to store the compiled unit \'" << path.string() << "\' (" << ec.message() << ").\n";
+		}
+
+		inline void splice_into(BytecodeCompiler& bc)const{
+			bc.splice(this->m_code, this->m_code_size, this->m_slot_names, this->m_max_stack);
+		}
+
+		inline const std::vector<UnitDependency>& deps()const{
+			return this->m_deps;
+		}
+
+	private:
+		static std::filesystem::path path_of(const Unit& unit){
+			return Unit::import_dir() / ".tlcache" / (unit.name + ".tlc");
+		}
+
+		// The file may be damaged or written by a different version. The code
+		// leaves the stack empty at every jump and every jump target, hence its
+		// depth follows from the code in order. HALT has to be the last instruction.
+		// The VM allocates the stack by max_stack, which is the maximum depth like
+		// the compiler computes it, so an implausible value is caught as well.
+		bool valid_code()const{
+			std::vector<bool> targets(this->m_code_size, false);
+			std::vector<bool> loop_heads(this->m_code_size, false);
+			for(uint32_t i = 0; i < this->m_code_size; ++i){
+				const Instr& instr = this->m_code[i];
+				if((OpCode::HALT == instr.op) != (this->m_code_size - 1 == i))
+					return false;
+
+				if(CompiledUnit::is_jump(instr.op) || OpCode::ENTER == instr.op){
+					if(instr.arg >= this->m_code_size)
+						return false;
+
+					(OpCode::ENTER == instr.op ? loop_heads : targets)[instr.arg] = true;
+				}
+			}
+
+			// A stopped loop is resumed at its head.
+			for(uint32_t i = 0; i < this->m_code_size; ++i)
+				if(loop_heads[i] && !targets[i])
+					return false;
+
+			uint32_t depth = 0;
+			uint32_t max_depth = 0;
+			for(uint32_t i = 0; i < this->m_code_size; ++i){
+				const Instr& instr = this->m_code[i];
+				if(targets[i] && 0 != depth)
+					return false;
+
+				uint32_t pops = 0;
+				uint32_t pushes = 0;
+				switch(instr.op){
+					case OpCode::PUSH:
+						pushes = 1;
+						break;
+					case OpCode::LOAD:
+					case OpCode::STORE:
+						if(instr.arg >= this->m_slot_names.size())
+							return false;
+
+						(OpCode::LOAD == instr.op ? pushes : pops) = 1;
+						break;
+					case OpCode::ADD:
+					case OpCode::SUB:
+					case OpCode::MUL:
+						pops = 2;
+						pushes = 1;
+						break;
+					case OpCode::JUMP_IF_NOT_POS:
+						pops = 1;
+						break;
+					case OpCode::JUMP:
+					case OpCode::ENTER:
+					case OpCode::LOOP:
+					case OpCode::HALT:
+						break;
+					default:
+						return false;
+				}
+
+				if(depth < pops)
+					return false;
+
+				depth = depth - pops + pushes;
+				max_depth = std::max(max_depth, depth);
+
+				// Jumps, the conditional one behind its pop, loop bodies and HALT leave the stack empty.
+				if(0 != depth && (CompiledUnit::is_jump(instr.op) || OpCode::ENTER == instr.op || OpCode::HALT == instr.op))
+					return false;
+			}
+
+			return max_depth == this->m_max_stack;
+		}
+
+		static inline bool is_jump(const OpCode op){
+			return OpCode::JUMP == op || OpCode::JUMP_IF_NOT_POS == op || OpCode::LOOP == op;
+		}
+
+		bool deps_unchanged()const{
+			return std::none_of(this->m_deps.begin(), this->m_deps.end(), [](const UnitDependency& dep){
+				return Unit::changed(dep.name, dep.hash);
+			});
+		}
+};
+
+#endif	// COMPILED_UNIT_HPP
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef COST_HPP
+#define COST_HPP
+
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include "interval.hpp"
+#include "line_index.hpp"
+#include "types.hpp"
+
+// Counts saturate, UINT64_MAX stands for an unbounded count.
+static constexpr uint64_t UNBOUNDED_COUNT = UINT64_MAX;
+
+static inline uint64_t saturating_add(const uint64_t a, const uint64_t b){
+	uint64_t res{};
+	return __builtin_add_overflow(a, b, &res) ? UNBOUNDED_COUNT : res;
+}
+
+static inline uint64_t saturating_mul(const uint64_t a, const uint64_t b){
+	uint64_t res{};
+	return __builtin_mul_overflow(a, b, &res) ? UNBOUNDED_COUNT : res;
+}
+
+// The largest count within the interval, unbounded if the interval is.
+static inline uint64_t max_count(const Interval& interval){
+	if(interval.is_empty() || interval.hi <= 0)
+		return 0;
+
+	return (INT64_MAX == interval.hi) ? UNBOUNDED_COUNT : static_cast<uint64_t>(interval.hi);
+}
+
+// The values of a variable or an expression for the cost estimate: the
+// integers it may be and, if it may be a list, the lengths of the list.
+struct CostValue{
+	Interval ints;
+	Interval lens;
+
+	static constexpr CostValue none(){
+		return CostValue{Interval::empty(), Interval::empty()};
+	}
+
+	static constexpr CostValue of_int(const Interval& ints){
+		return CostValue{ints, Interval::empty()};
+	}
+
+	static constexpr CostValue of_list(const Interval& lens){
+		return CostValue{Interval::empty(), lens};
+	}
+
+	inline bool may_be_list()const{
+		return !this->lens.is_empty();
+	}
+
+	// Where an integer is expected, a list counts as its length.
+	inline Interval as_int()const{
+		return this->ints.join(this->lens);
+	}
+
+	inline CostValue join(const CostValue& other)const{
+		return CostValue{this->ints.join(other.ints), this->lens.join(other.lens)};
+	}
+};
+
+// The number of iterations of a single execution of a loop. Bounded if the
+// loop counts a variable towards a bound whose values are known, symbolic if
+// the values at the entry of the loop are unknown and unbounded otherwise.
+struct TripCount{
+	enum class Kind: uint8_t{
+		BOUNDED,
+		SYMBOLIC,
+		UNBOUNDED
+	};
+
+	Kind kind;
+
+	// Only set if bounded, 'exact' if the loop always iterates 'max' times
+	// and leaves the counter at 'exit'.
+	uint64_t max;
+	bool exact;
+	IntType exit;
+
+	// Only set if symbolic, in terms of the values at the entry of the loop.
+	std::string expr;
+
+	// The counting variable, empty if unbounded, which changes by 'step' in
+	// every iteration and takes 'values' within the body.
+	std::string_view counter;
+	IntType step;
+	Interval values;
+
+	static TripCount unbounded(){
+		return TripCount{Kind::UNBOUNDED, 0, false, 0, std::string{}, std::string_view{}, 0, Interval::full()};
+	}
+
+	static TripCount bounded(const uint64_t max, const bool exact){
+		return TripCount{Kind::BOUNDED, max, exact, 0, std::string{}, std::string_view{}, 0, Interval::full()};
+	}
+
+	inline uint64_t times()const{
+		return (Kind::BOUNDED == this->kind) ? this->max : UNBOUNDED_COUNT;
+	}
+
+	const char* kind_name()const{
+		static constexpr const char* names[] = {"bounded", "symbolic", "unbounded"};
+		return names[static_cast<uint8_t>(this->kind)];
+	}
+};
+
+// A loop of the program, 'depth' is the number of loops around it.
+struct LoopCost{
+	SourceLocation loc;
+	uint32_t depth;
+	TripCount trips;
+};
+
+#endif	// COST_HPP
\ No newline at end of file
@@ -0,0 +1,300 @@
+#ifndef EXEC_LIMITS_HPP
+#define EXEC_LIMITS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <ostream>
+
+#include <cstddef>
+#include <cstdint>
+
+enum class LimitType: uint8_t{
+	NONE,
+
+	STEPS,
+	TIMEOUT,
+	INTERRUPTED,
+	LIST_SIZE,
+	SYNTAX_ERROR	// in a body parsed lazily, see LazyNode
+};
+
+// The limits of a single evaluation, shared by all of its threads. A step is
+// a loop iteration or ExecLimits::LIST_STEP elements of a list operation.
+class ExecBudget{
+	public:
+		// 1 GiB of elements, larger lists stop the evaluation instead of aborting it.
+		static constexpr uint64_t MAX_LIST_SIZE = uint64_t{1} << 27;
+
+	private:
+		static constexpr uint64_t SHARES = 64;
+
+		std::atomic<uint64_t> m_steps;
+		std::atomic<bool> m_cancelled;
+		std::atomic<LimitType> m_exceeded;
+
+		const uint64_t m_max_steps;
+		const uint32_t m_timeout_ms;
+
+	public:
+		// A limit of 0 means unlimited.
+		explicit ExecBudget(const uint64_t max_steps = 0, const uint32_t timeout_ms = 0):
+			m_steps{(0 == max_steps) ? UINT64_MAX : max_steps},
+			m_cancelled{false},
+			m_exceeded{LimitType::NONE},
+			m_max_steps{max_steps},
+			m_timeout_ms{timeout_ms}{
+		}
+
+		inline bool cancelled()const{
+			return this->m_cancelled.load(std::memory_order_relaxed);
+		}
+
+		inline LimitType exceeded()const{
+			return this->m_exceeded.load();
+		}
+
+		inline uint32_t timeout_ms()const{
+			return this->m_timeout_ms;
+		}
+
+		// Hands out up to 'n' steps, 0 if the budget is exhausted. Close to the
+		// end of the budget, fewer steps are handed out at once, so threads which
+		// hold steps they do not need leave the remaining ones to the others.
+		uint64_t take(const uint64_t n){
+			uint64_t steps = this->m_steps.load();
+			uint64_t taken{};
+
+			do{
+				taken = std::min(n, std::max(steps / ExecBudget::SHARES, std::min(steps, uint64_t{1})));
+			}while(!this->m_steps.compare_exchange_weak(steps, steps - taken));
+
+			if(0 == taken)
+				this->cancel(LimitType::STEPS);
+
+			return taken;
+		}
+
+		// Returns steps which were taken but not used.
+		inline void give_back(const uint64_t n){
+			this->m_steps.fetch_add(n);
+		}
+
+		void cancel(const LimitType reason){
+			LimitType none = LimitType::NONE;
+			this->m_exceeded.compare_exchange_strong(none, reason);
+			this->m_cancelled.store(true);
+		}
+
+		void report(std::ostream& os)const{
+			switch(this->exceeded()){
+				case LimitType::STEPS:
+					os << "error[runtime]: Step limit of " << this->m_max_steps
+					   << " steps exceeded, execution stopped.\n";
+					break;
+				case LimitType::TIMEOUT:
+					os << "error[runtime]: Timeout of " << this->m_timeout_ms
+					   << " ms exceeded, execution stopped.\n";
+					break;
+				case LimitType::INTERRUPTED:
+					os << "error[runtime]: Interrupted, execution stopped.\n";
+					break;
+				case LimitType::LIST_SIZE:
+					os << "error[runtime]: List size limit of " << ExecBudget::MAX_LIST_SIZE
+					   << " elements exceeded, execution stopped.\n";
+					break;
+				case LimitType::SYNTAX_ERROR:
+					os << "error[runtime]: Syntax error in a lazily parsed body, execution stopped.\n";
+					break;
+				case LimitType::NONE:
+					break;
+			}
+		}
+};
+
+// Per thread view of the budget of the evaluation running on the thread.
+// Steps are counted for loop iterations and for long list operations and are
+// taken from the shared budget in chunks, hence the hot path is a decrement
+// and a relaxed load.
+class ExecLimits{
+	public:
+		// Shorter list operations are free.
+		static constexpr uint64_t LIST_STEP = 1024;
+
+	private:
+		static constexpr uint64_t CHUNK = 4096;
+
+		// Long list operations are split into blocks, whose steps are taken before
+		// they run, so the limits apply within a single operation as well.
+		static constexpr uint64_t BLOCK = uint64_t{1} << 16;
+
+		ExecBudget* m_budget;
+		uint64_t m_steps;
+		bool m_stopped;
+
+	public:
+		explicit ExecLimits(): m_budget{nullptr}, m_steps{UINT64_MAX}, m_stopped{false}{
+		}
+
+		// The unused steps of the previous budget are given back, so a budget
+		// may be attached and detached repeatedly, e.g. for every time slice.
+		void attach(ExecBudget* const budget){
+			if(this->m_budget && !this->m_stopped)
+				this->m_budget->give_back(this->m_steps);
+
+			// Steps are taken on the first iteration, threads which never loop take none.
+			this->m_budget = budget;
+			this->m_steps = (nullptr == budget) ? UINT64_MAX : 0;
+			this->m_stopped = (nullptr != budget) && budget->cancelled();
+		}
+
+		inline ExecBudget* budget()const{
+			return this->m_budget;
+		}
+
+		inline bool stopped()const{
+			return this->m_stopped;
+		}
+
+		// Called in front of every loop body, returns false if the loop has to stop.
+		// A budget of N steps allows exactly N iterations.
+		inline bool tick(){
+			if(0 != this->m_steps && !(this->m_budget && this->m_budget->cancelled())){
+				--this->m_steps;
+				return true;
+			}
+
+			return this->refill();
+		}
+
+		// Takes 'steps' steps at once, returns false if the evaluation has to stop.
+		bool charge(uint64_t steps){
+			while(0 != steps){
+				if(!this->tick())
+					return false;
+
+				const uint64_t n = std::min(steps - 1, this->m_steps);
+				this->m_steps -= n;
+				steps -= n + 1;
+			}
+
+			return true;
+		}
+
+		// Calls 'f(begin, end)' for the blocks of an operation on 'n' list elements,
+		// returns false if the evaluation stopped before every block was done.
+		template <typename F>
+		bool for_blocks(const size_t n, F f){
+			for(size_t begin = 0; begin < n; begin += ExecLimits::BLOCK){
+				const size_t end = std::min(n, begin + static_cast<size_t>(ExecLimits::BLOCK));
+				if(!this->charge((end - begin) / ExecLimits::LIST_STEP))
+					return false;
+
+				f(begin, end);
+			}
+
+			return true;
+		}
+
+		// Lists are created with at most MAX_LIST_SIZE elements, otherwise the
+		// evaluation is stopped and false is returned.
+		bool admit_list(const uint64_t n){
+			if(n <= ExecBudget::MAX_LIST_SIZE)
+				return true;
+
+			this->stop(LimitType::LIST_SIZE);
+			return false;
+		}
+
+		// Stops the evaluation running on the thread, if any.
+		void stop(const LimitType reason){
+			if(nullptr != this->m_budget){
+				this->m_budget->cancel(reason);
+				this->m_stopped = true;
+			}
+		}
+
+	private:
+		// The step of the current iteration is taken from the new chunk.
+		bool refill(){
+			if(nullptr == this->m_budget){
+				this->m_steps = UINT64_MAX - 1;
+				return true;
+			}
+
+			if(!this->m_budget->cancelled()){
+				this->m_steps = this->m_budget->take(CHUNK);
+				if(0 != this->m_steps)
+					--this->m_steps;
+			}
+
+			this->m_stopped = this->m_budget->cancelled();
+			return !this->m_stopped;
+		}
+};
+
+static thread_local ExecLimits exec_limits{};
+
+// Attaches a budget to the current thread for the lifetime of the guard.
+class ExecLimitsGuard{
+	private:
+		ExecBudget* const m_prev;
+
+	public:
+		explicit ExecLimitsGuard(ExecBudget* const budget): m_prev{exec_limits.budget()}{
+			exec_limits.attach(budget);
+		}
+
+		ExecLimitsGuard(const ExecLimitsGuard&) = delete;
+		ExecLimitsGuard& operator= (const ExecLimitsGuard&) = delete;
+
+		~ExecLimitsGuard(){
+			exec_limits.attach(this->m_prev);
+		}
+};
+
+// Cancels the budget once its timeout expires unless it is destroyed before.
+class Watchdog{
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		bool m_done;
+
+		std::thread m_thread;
+
+	public:
+		explicit Watchdog(ExecBudget& budget): m_mutex{}, m_cv{}, m_done{false}, m_thread{}{
+			if(0 != budget.timeout_ms())
+				this->m_thread = std::thread{&Watchdog::watch, this, std::ref(budget)};
+		}
+
+		Watchdog(const Watchdog&) = delete;
+		Watchdog& operator= (const Watchdog&) = delete;
+
+		~Watchdog(){
+			if(this->m_thread.joinable()){
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					this->m_done = true;
+				}
+
+				this->m_cv.notify_one();
+				this->m_thread.join();
+			}
+		}
+
+	private:
+		void watch(ExecBudget& budget){
+			std::unique_lock<std::mutex> lock{this->m_mutex};
+
+			const auto timeout = std::chrono::milliseconds{budget.timeout_ms()};
+			if(!this->m_cv.wait_for(lock, timeout, [this]{ return this->m_done; }))
+				budget.cancel(LimitType::TIMEOUT);
+		}
+};
+
+#endif	// EXEC_LIMITS_HPP
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef IMPORT_NODE_HPP
+#define IMPORT_NODE_HPP
+
+#include <memory>
+#include <vector>
+
+#include <ostream>
+
+#include <cstdint>
+
+#include "ast_node.hpp"
+#include "shared_nodes.hpp"
+#include "unit.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "temp_pool.hpp"
+#include "relocation.hpp"
+#include "line_index.hpp"
+#include "token_position.hpp"
+#include "types.hpp"
+
+// (import name) spliced in the instruction list of a unit, i.e. the unit is
+// evaluated as if its instructions were written in place of the import. The
+// nodes of the list refer to the code of the unit, hence they are located
+// within the unit and never relocated with the program.
+class ImportNode final: public InstrNode{
+	private:
+		std::shared_ptr<const Unit> m_unit;
+
+		// Destroyed after the list, nullptr unless the unit is hash-consed.
+		std::unique_ptr<SharedNodes> m_shared_nodes;
+
+		NodePtr m_body;
+
+	public:
+		ImportNode(
+				std::shared_ptr<const Unit> unit,
+				BaseNode* const body,
+				std::unique_ptr<SharedNodes> shared_nodes,
+				const TokenPosition& pos
+			):
+				InstrNode{NodeKind::IMPORT, pos},
+				m_unit{std::move(unit)},
+				m_shared_nodes{std::move(shared_nodes)},
+				m_body{body}{
+		}
+
+		IntType eval(SymbolTable& sym_table)const override{
+			return this->m_body->eval(sym_table);
+		}
+
+		void pythonify(std::ostream& os, const uint16_t depth)const override{
+			BaseNode::indent_n(os, depth);
+			os << "# import " << this->m_unit->name << '\n';
+
+			this->m_body->pythonify(os, depth);
+		}
+
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			BaseNode::dump_placeholder(os, depth);
+			os << "ImportNode[" << this->m_unit->name << ", " << ctx.locate(this->m_pos) << "]:\n";
+
+			LineIndex lines{this->m_unit->code, this->m_unit->path};
+			DumpContext unit_ctx{lines};
+			this->m_body->dump(os, unit_ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			return new ImportNode{this->m_unit, this->m_body->clone(), nullptr, this->m_pos};
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->m_body->collect_vars(reads, writes);
+		}
+
+		void collect_list_vars(VarSet& lists)const override{
+			this->m_body->collect_list_vars(lists);
+		}
+
+		bool hoist_invariants(LoopInvariants& loop)override{
+			return this->m_body->hoist_invariants(loop);
+		}
+
+		BaseNode* optimize_loops(TempPool& temps)override{
+			BaseNode::optimize_loops_of(this->m_body, temps);
+			return nullptr;
+		}
+
+		void eliminate_common_subexprs(TempPool& temps)override{
+			this->m_body->eliminate_common_subexprs(temps);
+		}
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override{
+			return this->m_body->analyze_ranges(ra, as_int);
+		}
+
+		// The loops of the unit are located within its own source code.
+		CostValue estimate_cost(CostEstimate& ce)const override{
+			ce.visit();
+
+			LineIndex lines{this->m_unit->code, this->m_unit->path};
+			LineIndex* const prev = ce.set_lines(&lines);
+
+			const CostValue res = this->m_body->estimate_cost(ce);
+			ce.set_lines(prev);
+
+			return res;
+		}
+
+		// Edits of the program do not move the unit.
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+		}
+
+		// Changing the unit changes the hash of every program importing it.
+		uint64_t hash(const uint64_t seed)const override{
+			return this->m_body->hash(BaseNode::hash(seed));
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			this->m_body->count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			this->m_body->compile(bc);
+		}
+};
+
+#endif	// IMPORT_NODE_HPP
\ No newline at end of file
@@ -0,0 +1,256 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <string>
+#include <string_view>
+#include <sstream>
+
+#include <vector>
+#include <memory>
+#include <iterator>
+
+#include <cstdint>
+
+#include "ast.hpp"
+#include "parser.hpp"
+#include "ast_node.hpp"
+#include "relocation.hpp"
+
+struct TextEdit{
+	uint32_t offset;
+	uint32_t removed;
+	std::string inserted;
+};
+
+// Keeps the source code of a program together with its AST and applies
+// text edits by reparsing only the instructions the edit touches. Edits
+// may leave the code with syntax errors, e.g. while a parenthesis is typed,
+// the AST of the last code without them is kept until they are fixed.
+class IncrementalDocument{
+	private:
+		// A part of an instruction list which has to be reparsed,
+		// [first, last) are the affected instructions.
+		struct Region{
+			InstrListNode* list;
+
+			NodeList::iterator first;
+			NodeList::iterator last;
+
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		std::string m_code;
+		std::unique_ptr<Ast> m_ast;
+
+		// The AST refers to 'm_good_code' instead of 'm_code' unless 'm_synced'.
+		std::string m_good_code;
+		bool m_synced;
+
+		std::string m_diagnostics;
+
+	public:
+		explicit IncrementalDocument(std::string code):
+			m_code{std::move(code)}, m_ast{}, m_good_code{}, m_synced{false}, m_diagnostics{}{
+
+			this->reserve();
+
+			// Without code free of syntax errors, the AST is an empty program.
+			if(!this->parse())
+				this->m_ast = std::make_unique<Ast>(new InstrListNode{TokenPosition{0}}, this->m_good_code);
+		}
+
+		// The AST refers to the code of the document.
+		IncrementalDocument(const IncrementalDocument&) = delete;
+		IncrementalDocument& operator= (const IncrementalDocument&) = delete;
+
+		inline const std::string& code()const{
+			return this->m_code;
+		}
+
+		// The AST of the last code without syntax errors, see ok().
+		inline const Ast& ast()const{
+			return *this->m_ast;
+		}
+
+		// True if ast() is the AST of code().
+		inline bool ok()const{
+			return this->m_synced;
+		}
+
+		// The syntax errors of code(), empty if ok().
+		inline const std::string& diagnostics()const{
+			return this->m_diagnostics;
+		}
+
+		// Returns ok() after the edit.
+		bool edit(const TextEdit& edit){
+			// Instructions cannot be reparsed before the AST matches the code again.
+			if(!this->m_synced){
+				this->m_code.replace(edit.offset, edit.removed, edit.inserted);
+				return this->parse();
+			}
+
+			// The candidates from the innermost instruction list outwards.
+			std::vector<Region> regions{};
+			if(NodeKind::INSTR_LIST == this->m_ast->root().kind())
+				this->find_regions(static_cast<InstrListNode&>(this->m_ast->root()), edit, regions);
+
+			const uint32_t old_end = edit.offset + edit.removed;
+			const uint32_t new_end = edit.offset + static_cast<uint32_t>(edit.inserted.size());
+
+			// The code is edited in place, so unless the buffer has to grow
+			// the views in front of the edit stay valid. Only the addresses
+			// of the old buffer are needed for the relocation.
+			const std::string_view old_buffer = this->m_code;
+			const std::string removed = this->m_code.substr(edit.offset, edit.removed);
+			if(this->m_code.size() + edit.inserted.size() > this->m_code.capacity() + edit.removed){
+				std::string code{};
+				code.reserve(this->m_code.capacity() * 2);
+				code = this->m_code;
+
+				this->m_code.swap(code);
+			}
+
+			this->m_code.replace(edit.offset, edit.removed, edit.inserted);
+
+			const Relocation rel{old_buffer, this->m_code, edit.offset, old_end, new_end};
+
+			// The instructions which are replaced are relocated as well, but
+			// the reparsed ones are already positioned within the new code.
+			this->m_ast->root().relocate(rel);
+			this->m_ast->set_code(this->m_code);
+
+			for(auto region = regions.rbegin(); region != regions.rend(); ++region){
+				if(this->reparse(*region, rel.apply(region->end)))
+					return true;
+			}
+
+			// The edit touches the outermost parentheses or leaves them unbalanced.
+			if(this->parse())
+				return true;
+
+			// The AST has been relocated into the edited code already, hence
+			// the code in front of the edit is restored and parsed once more.
+			this->m_good_code = this->m_code;
+			this->m_good_code.replace(edit.offset, edit.inserted.size(), removed);
+
+			std::ostringstream ignored{};
+			Parser parser{this->m_good_code, ignored};
+			this->m_ast = std::make_unique<Ast>(parser.parse(), this->m_good_code);
+			this->m_synced = false;
+
+			return false;
+		}
+
+	private:
+		// Parses the whole code, the AST is only replaced if there are no syntax errors.
+		bool parse(){
+			std::ostringstream errors{};
+			Parser parser{this->m_code, errors};
+			NodePtr root{parser.parse()};
+
+			this->m_diagnostics = errors.str();
+			if(!parser.ok())
+				return false;
+
+			this->m_ast = std::make_unique<Ast>(root.release(), this->m_code);
+			this->m_good_code.clear();
+			this->m_synced = true;
+
+			return true;
+		}
+
+		inline void reserve(){
+			this->m_code.reserve(this->m_code.size() + this->m_code.size() / 8 + 4096);
+		}
+
+		static inline bool is_white_space(const char chr){
+			return ' ' == chr || '\t' == chr || '\n' == chr;
+		}
+
+		// The opening parenthesis in front of the keyword of an instruction.
+		uint32_t instr_begin(const BaseNode& instr)const{
+			uint32_t offset = instr.pos().offset();
+			while(offset > 0 && IncrementalDocument::is_white_space(this->m_code[offset - 1]))
+				--offset;
+
+			return (offset > 0 && '(' == this->m_code[offset - 1]) ? offset - 1 : UINT32_MAX;
+		}
+
+		// The regions of the instructions of 'list' partition its interior,
+		// i.e. every region includes the white space behind its instruction.
+		void find_regions(InstrListNode& list, const TextEdit& edit, std::vector<Region>& regions)const{
+			const uint32_t edit_end = edit.offset + edit.removed;
+			if(0 == list.end() || edit.offset <= list.pos().offset() || edit_end >= list.end())
+				return;
+
+			NodeList& instrs = list.instrs();
+			Region region{&list, instrs.end(), instrs.end(), list.pos().offset() + 1, list.end() - 1};
+
+			// The region of the first instruction includes the leading white space.
+			uint32_t begin = list.pos().offset() + 1;
+			for(auto it = instrs.begin(); it != instrs.end() && begin <= edit_end; ++it){
+				const auto next = std::next(it);
+				const uint32_t end = (next != instrs.end()) ? this->instr_begin(**next) : list.end() - 1;
+				if(UINT32_MAX == end)
+					return;
+
+				// An insertion in front of the closing parenthesis belongs to the last instruction.
+				const bool affected = (edit.offset < end && edit_end > begin)
+					|| (begin <= edit.offset && edit.offset < end)
+					|| (next == instrs.end() && edit.offset == end);
+
+				if(affected){
+					if(region.first == instrs.end()){
+						region.first = it;
+						region.begin = begin;
+					}
+
+					region.last = next;
+					region.end = end;
+				}
+
+				begin = end;
+			}
+
+			regions.push_back(region);
+
+			// Descend if a single instruction contains the edit within one of its lists.
+			if(region.first != instrs.end() && std::next(region.first) == region.last){
+				std::vector<InstrListNode*> nested{};
+				(*region.first)->collect_instr_lists(nested);
+
+				for(InstrListNode* const nested_list : nested){
+					const size_t region_cnt = regions.size();
+					this->find_regions(*nested_list, edit, regions);
+
+					if(regions.size() != region_cnt)
+						return;
+				}
+			}
+		}
+
+		// The region begins in front of the edit, i.e. its begin is not relocated.
+		bool reparse(const Region& region, const uint32_t end)const{
+			Parser parser{this->m_code, region.begin, end};
+
+			std::vector<BaseNode*> instrs = parser.parse_instrs();
+			if(!parser.ok()){
+				for(BaseNode* const instr : instrs)
+					delete instr;
+
+				return false;
+			}
+
+			NodeList& list = region.list->instrs();
+			const auto pos = list.erase(region.first, region.last);
+
+			for(BaseNode* const instr : instrs)
+				list.emplace(pos, instr);
+
+			return true;
+		}
+};
+
+#endif	// INCREMENTAL_HPP
\ No newline at end of file
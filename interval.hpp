@@ -0,0 +1,142 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include <algorithm>
+#include <limits>
+
+#include <ostream>
+
+#include <cstdint>
+
+#include "types.hpp"
+
+// A closed interval of integers, empty if lo > hi.
+struct Interval{
+	IntType lo;
+	IntType hi;
+
+	static constexpr Interval empty(){
+		return Interval{INT64_MAX, INT64_MIN};
+	}
+
+	static constexpr Interval full(){
+		return Interval{INT64_MIN, INT64_MAX};
+	}
+
+	static constexpr Interval point(const IntType value){
+		return Interval{value, value};
+	}
+
+	inline bool is_empty()const{
+		return this->lo > this->hi;
+	}
+
+	inline Interval join(const Interval& other)const{
+		if(this->is_empty())
+			return other;
+		if(other.is_empty())
+			return *this;
+
+		return Interval{std::min(this->lo, other.lo), std::max(this->hi, other.hi)};
+	}
+
+	inline Interval meet(const Interval& other)const{
+		const Interval res{std::max(this->lo, other.lo), std::min(this->hi, other.hi)};
+		return res.is_empty() ? Interval::empty() : res;
+	}
+
+	// Bounds which grew are moved to infinity, which ends the iteration of a loop.
+	inline Interval widen(const Interval& next)const{
+		if(this->is_empty())
+			return next;
+		if(next.is_empty())
+			return *this;
+
+		return Interval{
+			(next.lo < this->lo) ? INT64_MIN : this->lo,
+			(next.hi > this->hi) ? INT64_MAX : this->hi
+		};
+	}
+
+	template <typename T>
+	inline bool fits()const{
+		return this->is_empty() || (this->lo >= std::numeric_limits<T>::min() && this->hi <= std::numeric_limits<T>::max());
+	}
+
+	// The narrowest signed type which holds every value.
+	const char* type_name()const{
+		if(this->fits<int8_t>())
+			return "int8";
+		if(this->fits<int16_t>())
+			return "int16";
+		if(this->fits<int32_t>())
+			return "int32";
+
+		return "int64";
+	}
+
+	inline bool operator== (const Interval& other)const{
+		return (this->is_empty() && other.is_empty()) || (this->lo == other.lo && this->hi == other.hi);
+	}
+
+	inline bool operator!= (const Interval& other)const{
+		return !(*this == other);
+	}
+
+	friend std::ostream& operator<< (std::ostream& os, const Interval& interval){
+		if(interval.is_empty())
+			return os << "[]";
+
+		return os << '[' << interval.lo << ", " << interval.hi << ']';
+	}
+};
+
+// The values of an expression or a variable: the integers it may be and,
+// if it may be a list, the elements of the list. 'elems' is empty if every
+// such list is.
+struct ValueRange{
+	Interval ints;
+	Interval elems;
+	bool lists;
+
+	static constexpr ValueRange none(){
+		return ValueRange{Interval::empty(), Interval::empty(), false};
+	}
+
+	static constexpr ValueRange of_int(const Interval& ints){
+		return ValueRange{ints, Interval::empty(), false};
+	}
+
+	static constexpr ValueRange of_list(const Interval& elems){
+		return ValueRange{Interval::empty(), elems, true};
+	}
+
+	// Where an integer is expected, a list counts as its length.
+	inline Interval as_int()const{
+		return this->lists ? this->ints.join(Interval{0, INT64_MAX}) : this->ints;
+	}
+
+	inline bool includes(const ValueRange& other)const{
+		return this->ints.join(other.ints) == this->ints
+			&& this->elems.join(other.elems) == this->elems
+			&& (this->lists || !other.lists);
+	}
+
+	inline ValueRange join(const ValueRange& other)const{
+		return ValueRange{this->ints.join(other.ints), this->elems.join(other.elems), this->lists || other.lists};
+	}
+
+	inline ValueRange widen(const ValueRange& next)const{
+		return ValueRange{this->ints.widen(next.ints), this->elems.widen(next.elems), this->lists || next.lists};
+	}
+
+	inline bool operator== (const ValueRange& other)const{
+		return this->ints == other.ints && this->elems == other.elems && this->lists == other.lists;
+	}
+
+	inline bool operator!= (const ValueRange& other)const{
+		return !(*this == other);
+	}
+};
+
+#endif	// INTERVAL_HPP
\ No newline at end of file
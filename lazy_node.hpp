@@ -0,0 +1,196 @@
+#ifndef LAZY_NODE_HPP
+#define LAZY_NODE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <string>
+#include <ostream>
+#include <utility>
+
+#include <cstdint>
+
+#include "ast_node.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "temp_pool.hpp"
+#include "relocation.hpp"
+#include "token_position.hpp"
+#include "types.hpp"
+
+// The syntax errors of the lists parsed by LazyNodes, possibly in several
+// threads at once. They are reported once the evaluation is done, since
+// the evaluation cannot exit in the middle of it.
+class LazyErrors{
+	private:
+		mutable std::mutex m_mutex;
+		std::string m_errors;
+
+		// False as long as only the lexer found errors: like in the rest of the
+		// program, invalid characters are reported and skipped.
+		std::atomic<bool> m_fatal;
+
+	public:
+		explicit LazyErrors(): m_mutex{}, m_errors{}, m_fatal{false}{
+		}
+
+		LazyErrors(const LazyErrors&) = delete;
+		LazyErrors& operator=(const LazyErrors&) = delete;
+
+		inline bool fatal()const{
+			return this->m_fatal.load();
+		}
+
+		void add(const std::string& errors, const bool fatal){
+			const std::lock_guard<std::mutex> lock{this->m_mutex};
+			this->m_errors += errors;
+			if(fatal)
+				this->m_fatal.store(true);
+		}
+
+		// Returns the errors added since the last call.
+		std::string take(){
+			const std::lock_guard<std::mutex> lock{this->m_mutex};
+			return std::exchange(this->m_errors, std::string{});
+		}
+};
+
+// Stands in for an instruction list whose parentheses are balanced but
+// which has not been parsed yet. The list is parsed on first use (usually
+// its first execution), which is safe in several threads at once. Syntax
+// errors within the list are therefore found when it is parsed: they are
+// added to LazyErrors and stop the evaluation, see ExecLimits::stop().
+class LazyNode final: public BaseNode{
+	private:
+		const std::string& m_code;
+
+		// Offset behind the closing parenthesis.
+		const uint32_t m_end;
+
+		// Shared by the parser and every LazyNode it creates.
+		const std::shared_ptr<LazyErrors> m_errors;
+
+		mutable std::once_flag m_once;
+		mutable std::atomic<bool> m_parsed;
+		mutable NodePtr m_node;
+
+	public:
+		LazyNode(
+				const std::string& code,
+				const TokenPosition& pos,
+				const uint32_t end,
+				std::shared_ptr<LazyErrors> errors
+			):
+				BaseNode{NodeKind::LAZY, pos},
+				m_code{code},
+				m_end{end},
+				m_errors{std::move(errors)},
+				m_once{},
+				m_parsed{false},
+				m_node{}{
+		}
+
+		inline bool parsed()const{
+			return this->m_parsed.load(std::memory_order_acquire);
+		}
+
+		BaseNode& node()const{
+			std::call_once(this->m_once, [this](){
+				this->parse();
+				this->m_parsed.store(true, std::memory_order_release);
+			});
+
+			return *this->m_node;
+		}
+
+		const BaseNode& resolve()const override{
+			return this->node();
+		}
+
+		IntType eval(SymbolTable& sym_table)const override{
+			return this->node().eval(sym_table);
+		}
+
+		void pythonify(std::ostream& os, const uint16_t depth)const override{
+			this->node().pythonify(os, depth);
+		}
+
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			this->node().dump(os, ctx, depth);
+		}
+
+		BaseNode* clone()const override{
+			return this->node().clone();
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			this->node().collect_vars(reads, writes);
+		}
+
+		void collect_list_vars(VarSet& lists)const override{
+			this->node().collect_list_vars(lists);
+		}
+
+		bool hoist_invariants(LoopInvariants& loop)override{
+			return this->node().hoist_invariants(loop);
+		}
+
+		BaseNode* optimize_loops(TempPool& temps)override{
+			this->node();
+			BaseNode::optimize_loops_of(this->m_node, temps);
+
+			return nullptr;
+		}
+
+		uint32_t number_values(ValueNumbering& vn)const override{
+			return this->node().number_values(vn);
+		}
+
+		void replace_common_subexprs(ValueNumbering& vn)override{
+			this->node().replace_common_subexprs(vn);
+		}
+
+		void eliminate_common_subexprs(TempPool& temps)override{
+			this->node().eliminate_common_subexprs(temps);
+		}
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override{
+			return this->node().analyze_ranges(ra, as_int);
+		}
+
+		CostValue estimate_cost(CostEstimate& ce)const override{
+			return this->node().estimate_cost(ce);
+		}
+
+		void relocate(const Relocation& rel)override{
+			this->node().relocate(rel);
+		}
+
+		void collect_instr_lists(std::vector<InstrListNode*>& lists)override{
+			this->node().collect_instr_lists(lists);
+		}
+
+		uint64_t hash(const uint64_t seed)const override{
+			return this->node().hash(seed);
+		}
+
+		// Lists which have not been parsed are counted as such.
+		void count_nodes(NodeCounts& counts)const override{
+			if(this->parsed())
+				this->m_node->count_nodes(counts);
+			else
+				BaseNode::count_nodes(counts);
+		}
+
+		void compile(BytecodeCompiler& bc)const override{
+			this->node().compile(bc);
+		}
+
+	private:
+		// Defined in parser.hpp.
+		inline void parse()const;
+};
+
+#endif	// LAZY_NODE_HPP
\ No newline at end of file
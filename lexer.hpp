@@ -1,6 +1,10 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <array>
+#include <chrono>
+#include <algorithm>
+
 #include <string>
 #include <string_view>
 
@@ -11,52 +15,196 @@
 #include <cstdint>
 
 #include "token.hpp"
+#include "line_index.hpp"
 #include "util.hpp"
 
+// The tokens a lexer read and the time it took, see --stats. Reading the
+// clock takes longer than lexing a token, hence only every SAMPLE_STRIDE-th
+// token is timed and the time of the others is estimated from them. The
+// time of reading the clock itself is measured and left out.
+struct LexStats{
+	static constexpr uint64_t SAMPLE_STRIDE = 31;
+
+	std::array<uint64_t, TOKEN_TYPE_CNT> tokens{};
+
+	uint64_t reads = 0;
+	std::chrono::steady_clock::duration sampled_time{};
+
+	// Set if the lexer ran on a thread of its own, i.e. concurrently to the parser.
+	bool concurrent = false;
+
+	double ms()const{
+		const uint64_t samples = (this->reads + SAMPLE_STRIDE - 1) / SAMPLE_STRIDE;
+		if(0 == samples)
+			return 0.0;
+
+		const double sampled_ms = std::chrono::duration<double, std::milli>(this->sampled_time).count()
+			- static_cast<double>(samples) * LexStats::clock_ms();
+
+		return std::max(sampled_ms, 0.0) * static_cast<double>(this->reads) / static_cast<double>(samples);
+	}
+
+	// The mean time between two consecutive readings of the clock.
+	static double clock_ms(){
+		static constexpr uint32_t READINGS = 4096;
+
+		std::chrono::steady_clock::duration total{};
+		for(uint32_t i = 0; i < READINGS; ++i){
+			const auto start = std::chrono::steady_clock::now();
+			total += std::chrono::steady_clock::now() - start;
+		}
+
+		return std::chrono::duration<double, std::milli>(total).count() / READINGS;
+	}
+};
+
 class Lexer{
 	private:
 		char m_chr;
+		std::string::const_iterator m_begin;
 		std::string::const_iterator m_it;
 		std::string::const_iterator m_end;
 
-		TokenPosition m_pos;
+		// Only used to report errors, hence built lazily.
+		mutable LineIndex m_lines;
+
+		// Errors are only recorded if 'm_errors' is nullptr.
+		std::ostream* const m_errors;
+		bool m_ok;
+
+		// Tokens are only counted and timed unless it is nullptr.
+		LexStats* m_stats;
 
 	public:
 		explicit Lexer(const std::string& code):
-			m_chr{'\0'}, m_it{code.cbegin()}, m_end{code.cend()}, m_pos{}{
+			Lexer{code, 0, static_cast<uint32_t>(code.size()), &std::cerr}{
+		}
+
+		// Lexes code[begin, end) only, the end is reported as CONTR_EOF.
+		Lexer(const std::string& code, const uint32_t begin, const uint32_t end, std::ostream* const errors):
+			m_chr{'\0'},
+			m_begin{code.cbegin()},
+			m_it{code.cbegin() + begin},
+			m_end{code.cbegin() + end},
+			m_lines{code},
+			m_errors{errors},
+			m_ok{true},
+			m_stats{nullptr}{
 
 			if(this->m_it != this->m_end)
 				this->m_chr = *this->m_it;
 		}
 
-		void read_next_token(Token& token){
+		inline bool ok()const{
+			return this->m_ok;
+		}
+
+		inline LineIndex& lines()const{
+			return this->m_lines;
+		}
+
+		inline void record(LexStats* const stats){
+			this->m_stats = stats;
+		}
+
+		inline LexStats* stats()const{
+			return this->m_stats;
+		}
+
+		inline void read_next_token(Token& token){
+			this->read_recorded_token<false>(token);
+		}
+
+		// Like read_next_token() but returns false at an invalid char instead
+		// of reporting it, with the position of the char as the position of
+		// 'token'. The next call continues behind the char. See TokenPipe.
+		inline bool read_next_token_or_invalid(Token& token){
+			return this->read_recorded_token<true>(token);
+		}
+
+		// Reports the invalid char at 'pos' like read_next_token() would have.
+		void report_invalid_char(const TokenPosition& pos){
+			this->m_ok = false;
+			if(!this->m_errors)
+				return;
+
+			const char chr = this->m_begin[pos.offset()];
+
+			std::ostringstream oss{};
+			oss << "error[lexer, " << this->m_lines.locate(pos) << "]: invalid char \'" << chr << '\''
+				<< " (ASCII: " << static_cast<uint16_t>(chr) << ").\n";
+
+			*this->m_errors << oss.str();
+		}
+
+		// Called behind an opening parenthesis, skips the text up to the matching
+		// closing parenthesis without lexing it and sets 'end' behind the latter.
+		// Returns false (and does not move) if the parentheses are unbalanced.
+		bool skip_balanced(uint32_t& end){
+			uint32_t depth = 1;
+			for(auto it = this->m_it; it != this->m_end && '\0' != *it; ++it){
+				if('(' == *it)
+					++depth;
+				else if(')' == *it && 0 == --depth){
+					this->m_it = it;
+					this->read_next_char();
+					end = this->pos().offset();
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+	private:
+		// CONTR_EOF, which is read over and over again, is counted once.
+		template <bool DEFER_INVALID>
+		inline bool read_recorded_token(Token& token){
+			if(!this->m_stats)
+				return this->read_token<DEFER_INVALID>(token);
+
+			bool res{};
+			if(0 == this->m_stats->reads++ % LexStats::SAMPLE_STRIDE){
+				const auto start = std::chrono::steady_clock::now();
+				res = this->read_token<DEFER_INVALID>(token);
+				this->m_stats->sampled_time += std::chrono::steady_clock::now() - start;
+			}else
+				res = this->read_token<DEFER_INVALID>(token);
+
+			uint64_t& cnt = this->m_stats->tokens[static_cast<uint8_t>(token.type())];
+			if(res && (TokenType::CONTR_EOF != token.type() || 0 == cnt))
+				++cnt;
+
+			return res;
+		}
+
+		template <bool DEFER_INVALID>
+		bool read_token(Token& token){
 			while(true){
 				switch(this->m_chr){
-					case '\n':
-						this->m_pos.inc_line();
-					[[fallthrough]];
-					case ' ': case '\t':
+					case ' ': case '\t': case '\n':
 						this->read_next_char();
 						break;
 					case '\0':
-						token.set(TokenType::CONTR_EOF, this->m_pos);
-						return;
+						token.set(TokenType::CONTR_EOF, this->pos());
+						return true;
 					case '(':
-						token.set(TokenType::L_PAR, this->m_pos);
+						token.set(TokenType::L_PAR, this->pos());
 						this->read_next_char();
-						return;
+						return true;
 					case ')':
-						token.set(TokenType::R_PAR, this->m_pos);
+						token.set(TokenType::R_PAR, this->pos());
 						this->read_next_char();
-						return;
+						return true;
 					case '0':
-						token.set(TokenType::INTEGER, ZERO_SV, this->m_pos);
+						token.set(TokenType::INTEGER, ZERO_SV, this->pos());
 						this->read_next_char();
-						return;
+						return true;
 					case '1': case '2': case '3':
 					case '4': case '5': case '6':
 					case '7': case '8': case '9': {
-						TokenPosition int_pos{this->m_pos.col(), this->m_pos.line()};
+						const TokenPosition int_pos = this->pos();
 						std::string::const_iterator int_begin = this->m_it;
 
 						do{
@@ -65,7 +213,7 @@ class Lexer{
 
 						std::string_view buffer = sv_from_range(int_begin, this->m_it);
 						token.set(TokenType::INTEGER, buffer, int_pos);
-						return;
+						return true;
 					}
 					case 'a': case 'b': case 'c': case 'd':
 					case 'e': case 'f': case 'g': case 'h':
@@ -74,7 +222,7 @@ class Lexer{
 					case 'q': case 'r': case 's': case 't':
 					case 'u': case 'v': case 'w': case 'x':
 					case 'y': case 'z': {
-						TokenPosition ident_pos{this->m_pos.col(), this->m_pos.line()};
+						const TokenPosition ident_pos = this->pos();
 						std::string::const_iterator ident_begin = this->m_it;
 
 						do{
@@ -83,32 +231,39 @@ class Lexer{
 
 						std::string_view buffer = sv_from_range(ident_begin, this->m_it);
 
-						const auto res = keyword_table.find(buffer);
-						if(res != keyword_table.end())
-							token.set(res->second, ident_pos);
+						TokenType keyword{};
+						if(find_keyword(buffer, keyword))
+							token.set(keyword, ident_pos);
 						else
 							token.set(TokenType::IDENT, buffer, ident_pos);
 
-						return;
+						return true;
 					}
 					default: {
-						std::ostringstream oss{};
-						oss << "error[lexer, " << this->m_pos << "]: invalid char \'" << this->m_chr << '\''
-							<< " (ASCII: " << static_cast<uint16_t>(this->m_chr) << ").\n";
+						if constexpr(DEFER_INVALID){
+							token.set(TokenType::CONTR_EOF, this->pos());
+							this->read_next_char();
+
+							return false;
+						}
 
-						std::cerr << oss.str();
+						this->report_invalid_char(this->pos());
 						this->read_next_char();
 					}
 				}
 			}
+		}
 
-			token.set(TokenType::CONTR_EOF, this->m_pos);
+		inline TokenPosition pos()const{
+			return TokenPosition{static_cast<uint32_t>(this->m_it - this->m_begin)};
 		}
 
-	private:
 		inline void read_next_char(){
-			this->m_pos.inc_col();
-			this->m_chr = (this->m_it != this->m_end) ? *++this->m_it : '\0';
+			// The end of a sub-range is not necessarily the terminating '\0'.
+			if(this->m_it != this->m_end)
+				++this->m_it;
+
+			this->m_chr = (this->m_it != this->m_end) ? *this->m_it : '\0';
 		}
 };
 
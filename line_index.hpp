@@ -0,0 +1,95 @@
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include <string_view>
+
+#include <vector>
+#include <algorithm>
+
+#include <ostream>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __SSE2__
+#	include <emmintrin.h>
+#endif
+
+#include "token_position.hpp"
+
+// 'source' is empty within the program itself, otherwise it names the imported file.
+struct SourceLocation{
+	std::string_view source;
+	uint32_t line;
+	uint32_t col;
+
+	friend std::ostream& operator<< (std::ostream& os, const SourceLocation& loc){
+		if(!loc.source.empty())
+			os << loc.source << ", ";
+
+		return os << "ln: " << loc.line << ", col: " << loc.col;
+	}
+};
+
+// Maps byte offsets to lines and columns, both starting at 1. The
+// offsets of the line starts are only collected on the first lookup,
+// i.e. a program which is neither dumped nor erroneous never pays for it.
+// Not thread-safe, every thread uses its own index.
+class LineIndex{
+	private:
+		std::string_view m_code;
+		std::string_view m_source;
+		std::vector<uint32_t> m_line_starts;
+
+	public:
+		explicit LineIndex(const std::string_view& code, const std::string_view& source = {}):
+			m_code{code}, m_source{source}, m_line_starts{}{
+		}
+
+		// Names the file of the code within the locations, see SourceLocation.
+		inline void set_source(const std::string_view& source){
+			this->m_source = source;
+		}
+
+		SourceLocation locate(const TokenPosition& pos){
+			if(this->m_line_starts.empty())
+				this->build();
+
+			const auto line = std::upper_bound(this->m_line_starts.cbegin(), this->m_line_starts.cend(), pos.offset());
+			return SourceLocation{
+				this->m_source,
+				static_cast<uint32_t>(line - this->m_line_starts.cbegin()),
+				pos.offset() - *(line - 1) + 1
+			};
+		}
+
+	private:
+		void build(){
+			this->m_line_starts.push_back(0);
+
+			const char* const data = this->m_code.data();
+			const size_t size = this->m_code.size();
+			size_t offset = 0;
+
+#			ifdef __SSE2__
+				// Compares 16 bytes at once, the set bits of the mask are the newlines.
+				const __m128i newline = _mm_set1_epi8('\n');
+				for(; offset + 16 <= size; offset += 16){
+					const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+					uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+
+					while(0 != mask){
+						this->m_line_starts.push_back(static_cast<uint32_t>(offset) + __builtin_ctz(mask) + 1);
+						mask &= mask - 1;
+					}
+				}
+#			endif
+
+			for(; offset < size; ++offset){
+				if('\n' == data[offset])
+					this->m_line_starts.push_back(static_cast<uint32_t>(offset) + 1);
+			}
+		}
+};
+
+#endif	// LINE_INDEX_HPP
\ No newline at end of file
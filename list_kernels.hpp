@@ -0,0 +1,157 @@
+#ifndef LIST_KERNELS_HPP
+#define LIST_KERNELS_HPP
+
+#include <algorithm>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __AVX2__
+#	include <immintrin.h>
+#endif
+
+#include "types.hpp"
+
+// The operations of the kernels, overflows wrap around.
+struct AddOp{
+	static inline IntType apply(const IntType a, const IntType b){
+		return static_cast<IntType>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+	}
+
+#	ifdef __AVX2__
+		static inline __m256i apply(const __m256i a, const __m256i b){
+			return _mm256_add_epi64(a, b);
+		}
+#	endif
+};
+
+struct SubOp{
+	static inline IntType apply(const IntType a, const IntType b){
+		return static_cast<IntType>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+	}
+
+#	ifdef __AVX2__
+		static inline __m256i apply(const __m256i a, const __m256i b){
+			return _mm256_sub_epi64(a, b);
+		}
+#	endif
+};
+
+struct MulOp{
+	static inline IntType apply(const IntType a, const IntType b){
+		return static_cast<IntType>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+	}
+
+#	ifdef __AVX2__
+		// AVX2 lacks a 64 bit multiplication, the low halves of the
+		// products are composed of 32 bit multiplications instead.
+		static inline __m256i apply(const __m256i a, const __m256i b){
+#			if defined(__AVX512DQ__) && defined(__AVX512VL__)
+				return _mm256_mullo_epi64(a, b);
+#			else
+				const __m256i low = _mm256_mul_epu32(a, b);
+				const __m256i cross = _mm256_add_epi64(
+					_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+					_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32))
+				);
+
+				return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+#			endif
+		}
+#	endif
+};
+
+// Only for operands which fit in 32 bits, whose products always fit in 64
+// bits. A single instruction multiplies the sign-extended low halves then.
+struct NarrowMulOp{
+	static inline IntType apply(const IntType a, const IntType b){
+		return MulOp::apply(a, b);
+	}
+
+#	ifdef __AVX2__
+		static inline __m256i apply(const __m256i a, const __m256i b){
+			return _mm256_mul_epi32(a, b);
+		}
+#	endif
+};
+
+struct MaxOp{
+	static inline IntType apply(const IntType a, const IntType b){
+		return std::max(a, b);
+	}
+
+#	ifdef __AVX2__
+		static inline __m256i apply(const __m256i a, const __m256i b){
+			return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a));
+		}
+#	endif
+};
+
+// An operand of an element-wise operation, 'scalar' is broadcast if 'data' is nullptr.
+struct ListOperand{
+	const IntType* data;
+	IntType scalar;
+};
+
+// Element-wise operations and reductions over contiguous lists. With AVX2,
+// four elements are processed at once and the scalar loop handles the rest.
+class ListKernels{
+	private:
+		static constexpr size_t LANES = 4;
+
+	public:
+		template <typename Op>
+		static void zip(const ListOperand& a, const ListOperand& b, IntType* const out, const size_t n){
+			size_t i = 0;
+
+#			ifdef __AVX2__
+				const __m256i a_scalar = _mm256_set1_epi64x(a.scalar);
+				const __m256i b_scalar = _mm256_set1_epi64x(b.scalar);
+
+				for(; i + ListKernels::LANES <= n; i += ListKernels::LANES){
+					const __m256i va = a.data ? ListKernels::load(a.data + i) : a_scalar;
+					const __m256i vb = b.data ? ListKernels::load(b.data + i) : b_scalar;
+
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Op::apply(va, vb));
+				}
+#			endif
+
+			for(; i < n; ++i)
+				out[i] = Op::apply(a.data ? a.data[i] : a.scalar, b.data ? b.data[i] : b.scalar);
+		}
+
+		// 'init' has to be the neutral element of the operation.
+		template <typename Op>
+		static IntType reduce(const IntType* const data, const size_t n, const IntType init){
+			IntType res = init;
+			size_t i = 0;
+
+#			ifdef __AVX2__
+				if(n >= ListKernels::LANES){
+					__m256i acc = _mm256_set1_epi64x(init);
+					for(; i + ListKernels::LANES <= n; i += ListKernels::LANES)
+						acc = Op::apply(acc, ListKernels::load(data + i));
+
+					alignas(32) IntType lanes[ListKernels::LANES];
+					_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+
+					for(const IntType lane : lanes)
+						res = Op::apply(res, lane);
+				}
+#			endif
+
+			for(; i < n; ++i)
+				res = Op::apply(res, data[i]);
+
+			return res;
+		}
+
+	private:
+#		ifdef __AVX2__
+			static inline __m256i load(const IntType* const data){
+				return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+			}
+#		endif
+};
+
+#endif	// LIST_KERNELS_HPP
\ No newline at end of file
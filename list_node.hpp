@@ -0,0 +1,386 @@
+#ifndef LIST_NODE_HPP
+#define LIST_NODE_HPP
+
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <memory>
+
+#include <string_view>
+#include <ostream>
+#include <utility>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ast_node.hpp"
+#include "list_kernels.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "relocation.hpp"
+#include "token_position.hpp"
+#include "types.hpp"
+#include "value.hpp"
+
+// The operators on lists are no keywords, hence variables of the same name remain valid.
+static const std::unordered_map<std::string_view, NodeKind> list_op_table{
+	{"list", NodeKind::LIST},
+	{"range", NodeKind::RANGE},
+	{"at", NodeKind::AT},
+	{"len", NodeKind::LEN},
+	{"sum", NodeKind::SUM},
+	{"prod", NodeKind::PROD},
+	{"max", NodeKind::MAX}
+};
+
+// (list e...) and (range n) create lists of integers, (at l i) yields the
+// element i or 0 if the index is out of range, (len l), (sum l), (prod l) and
+// (max l) reduce a list, where max of an empty list is 0. A scalar operand is
+// treated like a list of a single element.
+class ListOpNode final: public BaseNode{
+	private:
+		std::vector<NodePtr> m_params;
+
+	public:
+		ListOpNode(const NodeKind kind, std::vector<NodePtr> params, const TokenPosition& pos):
+			BaseNode{kind, pos}, m_params{std::move(params)}{
+
+			this->m_may_yield_list = (NodeKind::LIST == kind || NodeKind::RANGE == kind);
+		}
+
+		// Returns 0 for the variadic list.
+		static size_t arity(const NodeKind kind){
+			switch(kind){
+				case NodeKind::LIST:
+					return 0;
+				case NodeKind::AT:
+					return 2;
+				default:
+					return 1;
+			}
+		}
+
+		// Avoids creating the list if only its length is of interest.
+		IntType eval(SymbolTable& sym_table)const override{
+			switch(this->m_kind){
+				case NodeKind::LIST:
+					for(const auto& param : this->m_params)
+						eval_node(*param, sym_table);
+
+					return static_cast<IntType>(this->m_params.size());
+				case NodeKind::RANGE:
+					return std::max(eval_node(*this->m_params[0], sym_table), IntType{});
+				case NodeKind::AT:
+					return this->eval_at(sym_table);
+				default:
+					return this->reduce(eval_value_node(*this->m_params[0], sym_table));
+			}
+		}
+
+		Value eval_value(SymbolTable& sym_table)const override{
+			switch(this->m_kind){
+				case NodeKind::LIST:{
+					auto res = std::make_shared<IntList>();
+					res->reserve(this->m_params.size());
+					for(const auto& param : this->m_params)
+						res->push_back(eval_node(*param, sym_table));
+
+					return Value{std::move(res)};
+				}
+				case NodeKind::RANGE:{
+					const IntType n = std::max(eval_node(*this->m_params[0], sym_table), IntType{});
+
+					auto res = std::make_shared<IntList>();
+					if(!exec_limits.admit_list(static_cast<uint64_t>(n)))
+						return Value{std::move(res)};
+
+					res->reserve(static_cast<size_t>(n));
+					exec_limits.for_blocks(static_cast<size_t>(n), [&res](const size_t begin, const size_t end){
+						res->resize(end);
+						std::iota(res->begin() + begin, res->end(), static_cast<IntType>(begin));
+					});
+
+					return Value{std::move(res)};
+				}
+				default:
+					return Value{this->eval(sym_table)};
+			}
+		}
+
+		void pythonify(std::ostream& os, const uint16_t depth)const override{
+			switch(this->m_kind){
+				case NodeKind::LIST:
+					os << '[';
+					for(size_t i = 0; i < this->m_params.size(); ++i){
+						os << ((0 == i) ? "" : ", ");
+						this->m_params[i]->pythonify(os, depth);
+					}
+					os << ']';
+					return;
+				case NodeKind::AT:
+					this->m_params[0]->pythonify(os, depth);
+					os << '[';
+					this->m_params[1]->pythonify(os, depth);
+					os << ']';
+					return;
+				default:
+					break;
+			}
+
+			static constexpr std::pair<NodeKind, const char*> functions[] = {
+				{NodeKind::RANGE, "list(range("},
+				{NodeKind::LEN, "len("},
+				{NodeKind::SUM, "sum("},
+				{NodeKind::PROD, "math.prod("},
+				{NodeKind::MAX, "max("}
+			};
+
+			for(const auto& function : functions){
+				if(function.first == this->m_kind)
+					os << function.second;
+			}
+
+			this->m_params[0]->pythonify(os, depth);
+			switch(this->m_kind){
+				case NodeKind::RANGE:
+					os << "))";
+					break;
+				case NodeKind::MAX:
+					os << ", default=0)";
+					break;
+				default:
+					os << ')';
+			}
+		}
+
+		void dump(std::ostream& os, DumpContext& ctx, const uint16_t depth)const override{
+			static constexpr const char* names[] = {
+				"ListNode", "RangeNode", "AtNode", "LenNode", "SumNode", "ProdNode", "MaxNode"
+			};
+
+			BaseNode::dump_placeholder(os, depth);
+			os << names[static_cast<uint8_t>(this->m_kind) - static_cast<uint8_t>(NodeKind::LIST)]
+				<< '[' << ctx.locate(this->m_pos) << "]:\n";
+
+			for(const auto& param : this->m_params)
+				param->dump(os, ctx, depth + 1);
+		}
+
+		BaseNode* clone()const override{
+			std::vector<NodePtr> params{};
+			params.reserve(this->m_params.size());
+			for(const auto& param : this->m_params)
+				params.emplace_back(param->clone());
+
+			return new ListOpNode{this->m_kind, std::move(params), this->m_pos};
+		}
+
+		void collect_vars(VarSet& reads, VarSet& writes)const override{
+			for(const auto& param : this->m_params)
+				param->collect_vars(reads, writes);
+		}
+
+		// Like ArithNode, e.g. a range which does not change within the loop is created once.
+		bool hoist_invariants(LoopInvariants& loop)override;
+
+		// The operators themselves are not numbered, their operands are.
+		uint32_t number_values(ValueNumbering& vn)const override;
+
+		void replace_common_subexprs(ValueNumbering& vn)override;
+
+		ValueRange analyze_ranges(RangeAnalysis& ra, const bool as_int)override;
+
+		// Creating and reducing a list counts its elements.
+		CostValue estimate_cost(CostEstimate& ce)const override;
+
+		void relocate(const Relocation& rel)override{
+			BaseNode::relocate(rel);
+			for(auto& param : this->m_params)
+				param->relocate(rel);
+		}
+
+		// The count separates the operands of nested lists.
+		uint64_t hash(const uint64_t seed)const override{
+			uint64_t res = BaseNode::hash_bytes(static_cast<uint32_t>(this->m_params.size()), BaseNode::hash(seed));
+			for(const auto& param : this->m_params)
+				res = param->hash(res);
+
+			return res;
+		}
+
+		void count_nodes(NodeCounts& counts)const override{
+			BaseNode::count_nodes(counts);
+			for(const auto& param : this->m_params)
+				param->count_nodes(counts);
+		}
+
+		// The VM only knows integers.
+		void compile(BytecodeCompiler& bc)const override{
+			bc.mark_unsupported();
+			bc.emit_push(IntType{});
+		}
+
+	private:
+		// The elements of a list, the length of a range and the index of at.
+		inline bool reads_as_int(const size_t param)const{
+			switch(this->m_kind){
+				case NodeKind::LIST:
+				case NodeKind::RANGE:
+					return true;
+				case NodeKind::AT:
+					return 1 == param;
+				default:
+					return false;
+			}
+		}
+
+		IntType eval_at(SymbolTable& sym_table)const{
+			const Value list = eval_value_node(*this->m_params[0], sym_table);
+			const IntType idx = eval_node(*this->m_params[1], sym_table);
+
+			if(!list.is_list())
+				return (IntType{} == idx) ? list.as_int() : IntType{};
+
+			const IntList& elems = list.list();
+			return (idx >= IntType{} && static_cast<uint64_t>(idx) < elems.size())
+				? elems[static_cast<size_t>(idx)]
+				: IntType{};
+		}
+
+		IntType reduce(const Value& value)const{
+			if(NodeKind::LEN == this->m_kind)
+				return value.is_list() ? static_cast<IntType>(value.list().size()) : IntType{1};
+
+			if(!value.is_list())
+				return value.as_int();
+
+			const IntList& elems = value.list();
+			switch(this->m_kind){
+				case NodeKind::SUM:
+					return ListOpNode::reduce_blocks<AddOp>(elems, IntType{});
+				case NodeKind::PROD:
+					return ListOpNode::reduce_blocks<MulOp>(elems, IntType{1});
+				default:
+					return elems.empty()
+						? IntType{}
+						: ListOpNode::reduce_blocks<MaxOp>(elems, INT64_MIN);
+			}
+		}
+
+		// The partial results of the blocks are combined like the lanes of the kernel.
+		template <typename Op>
+		static IntType reduce_blocks(const IntList& elems, const IntType init){
+			IntType res = init;
+			exec_limits.for_blocks(elems.size(), [&res, &elems, init](const size_t begin, const size_t end){
+				res = Op::apply(res, ListKernels::reduce<Op>(elems.data() + begin, end - begin, init));
+			});
+
+			return res;
+		}
+};
+
+inline bool ListOpNode::hoist_invariants(LoopInvariants& loop){
+	std::vector<bool> invariant(this->m_params.size());
+	for(size_t i = 0; i < this->m_params.size(); ++i)
+		invariant[i] = this->m_params[i]->hoist_invariants(loop);
+
+	if(std::all_of(invariant.begin(), invariant.end(), [](const bool b){ return b; }))
+		return true;
+
+	for(size_t i = 0; i < this->m_params.size(); ++i){
+		if(invariant[i])
+			loop.hoist(this->m_params[i], this->reads_as_int(i));
+	}
+
+	return false;
+}
+
+inline uint32_t ListOpNode::number_values(ValueNumbering& vn)const{
+	for(const auto& param : this->m_params)
+		param->number_values(vn);
+
+	return vn.unique();
+}
+
+inline void ListOpNode::replace_common_subexprs(ValueNumbering& vn){
+	for(auto& param : this->m_params)
+		vn.replace(param);
+}
+
+inline ValueRange ListOpNode::analyze_ranges(RangeAnalysis& ra, const bool as_int){
+	switch(this->m_kind){
+		case NodeKind::LIST:{
+			Interval elems = Interval::empty();
+			for(const auto& param : this->m_params)
+				elems = elems.join(param->analyze_ranges(ra, true).ints);
+
+			return as_int
+				? ValueRange::of_int(Interval::point(static_cast<IntType>(this->m_params.size())))
+				: ValueRange::of_list(elems);
+		}
+		case NodeKind::RANGE:{
+			const Interval n = this->m_params[0]->analyze_ranges(ra, true).ints;
+			if(as_int)
+				return ValueRange::of_int(Interval{std::max(n.lo, IntType{}), std::max(n.hi, IntType{})});
+
+			return ValueRange::of_list((n.hi > 0) ? Interval{0, n.hi - 1} : Interval::empty());
+		}
+		case NodeKind::AT:{
+			const ValueRange list = this->m_params[0]->analyze_ranges(ra, false);
+			this->m_params[1]->analyze_ranges(ra, true);
+
+			return ValueRange::of_int(list.ints.join(list.elems).join(Interval::point(0)));
+		}
+		default:
+			break;
+	}
+
+	const ValueRange value = this->m_params[0]->analyze_ranges(ra, false);
+	if(!value.lists)
+		return ValueRange::of_int((NodeKind::LEN == this->m_kind) ? Interval::point(1) : value.ints);
+
+	switch(this->m_kind){
+		case NodeKind::LEN:
+			return ValueRange::of_int(Interval{0, INT64_MAX});
+		case NodeKind::MAX:
+			return ValueRange::of_int(value.ints.join(value.elems).join(Interval::point(0)));
+		default:
+			return ValueRange::of_int(Interval::full());
+	}
+}
+
+inline CostValue ListOpNode::estimate_cost(CostEstimate& ce)const{
+	ce.visit();
+
+	switch(this->m_kind){
+		case NodeKind::LIST:
+			for(const auto& param : this->m_params)
+				param->estimate_cost(ce);
+
+			return CostValue::of_list(Interval::point(static_cast<IntType>(this->m_params.size())));
+		case NodeKind::RANGE:{
+			const Interval n = this->m_params[0]->estimate_cost(ce).as_int();
+			const Interval lens = n.is_empty() ? n : Interval{std::max(n.lo, IntType{}), std::max(n.hi, IntType{})};
+
+			ce.add_elems(max_count(lens));
+			return CostValue::of_list(lens);
+		}
+		case NodeKind::AT:
+			this->m_params[0]->estimate_cost(ce);
+			this->m_params[1]->estimate_cost(ce);
+
+			return CostValue::of_int(Interval::full());
+		default:
+			break;
+	}
+
+	const CostValue value = this->m_params[0]->estimate_cost(ce);
+	if(NodeKind::LEN == this->m_kind)
+		return CostValue::of_int(value.ints.is_empty() ? value.lens : value.lens.join(Interval::point(1)));
+
+	ce.add_elems(max_count(value.lens));
+	return CostValue::of_int(value.may_be_list() ? Interval::full() : value.ints);
+}
+
+#endif	// LIST_NODE_HPP
\ No newline at end of file
@@ -1,63 +1,169 @@
 #include <string>
+#include <memory>
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 #include "ast.hpp"
+#include "run.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
 #include "parser.hpp"
-#include "sym_table.hpp"
-#include "types.hpp"
+#include "bytecode_parser.hpp"
+#include "server.hpp"
+#include "client.hpp"
 
 #include "arg_parser.hpp"
 
-static void interpret(const std::string& code){
-	Parser parser{code};
-	SymbolTable sym_table{};
-
-	const Ast ast = parser.parse();
-	const IntType res = ast.eval(sym_table);
-
-	std::ostringstream oss{};
-	oss << "-> " << res << '\n';
-
-	if(args.dump_ast)
-		ast.dump(oss << '\n');
-
-	if(args.dump_sym_table)
-		sym_table.dump(oss << '\n');
-
-	if(args.pythonify)
-		ast.pythonify(oss << '\n');
+// Unless an option needs the AST, the program is compiled while it is parsed.
+static bool needs_ast(){
+	return args.dump_ast || args.dump_ranges || args.estimate_cost || args.pythonify || args.optimize || args.hash_cons || args.lazy_parse
+		|| args.try_recovery_from_syntax_errors || args.tree_walker
+		|| (args.input_file.empty() && (args.threads > 1 || !args.cache_dir.empty()));
+}
 
-	std::cout << oss.str();
+// 'stats' is nullptr unless statistics are requested.
+static bool interpret(const std::string& code, Stats* const stats){
+	if(code.size() > MAX_CODE_SIZE){
+		std::cerr << "error: The program is larger than " << MAX_CODE_SIZE << " bytes.\n";
+		return false;
+	}
+
+	if(!args.connect_socket.empty())
+		return run_client(code);
+
+	if(!needs_ast()){
+		Program program{};
+		bool compiled{};
+		{
+			const PhaseTimer timer{stats, "parse"};
+			BytecodeParser parser{code};
+			if(stats)
+				parser.record_lexing(stats->lexing());
+			if(TokenPipe::pays_off(code))
+				parser.lex_concurrently();
+
+			compiled = parser.parse(program);
+		}
+
+		if(stats)
+			stats->separate_lexing();
+
+		// Otherwise the program uses lists.
+		if(compiled){
+			if(stats)
+				stats->count_instrs(program);
+
+			const bool ok = args.input_file.empty()
+				? run_compiled(program, RunOptions::from_args(), std::cout, std::cerr, stats)
+				: run_stream(program, StreamOptions::from_args(), std::cout, std::cerr);
+			{
+				const PhaseTimer timer{stats, "teardown"};
+				program = Program{};
+			}
+
+			return ok;
+		}
+	}
+
+	std::unique_ptr<Ast> ast{};
+	{
+		const PhaseTimer timer{stats, "parse"};
+
+		Parser parser{code};
+		if(stats)
+			parser.record_lexing(stats->lexing());
+		if(args.hash_cons)
+			parser.share_nodes();
+		if(args.lazy_parse)
+			parser.parse_lazily();
+		else if(TokenPipe::pays_off(code))
+			parser.lex_concurrently();
+
+		BaseNode* const root = parser.parse();
+		ast = std::make_unique<Ast>(root, code, parser.release_shared_nodes(), parser.lazy_errors());
+	}
+
+	if(stats)
+		stats->separate_lexing();
+
+	if(args.optimize){
+		const PhaseTimer timer{stats, "optimize"};
+		ast->optimize();
+	}
+
+	if(stats)
+		stats->count_nodes(*ast);
+
+	// Estimating the cost replaces the evaluation, the cost of a single record if streaming.
+	if(args.estimate_cost){
+		ast->estimate_cost(std::cout, args.input_file.empty() ? std::vector<std::string>{} : args.input_columns);
+		return ast->report_lazy_errors(std::cerr);
+	}
+
+	bool ok{};
+	if(args.input_file.empty())
+		ok = run_program(*ast, RunOptions::from_args(), std::cout, std::cerr, stats);
+	else{
+		const Program program = ast->compile();
+		ok = ast->report_lazy_errors(std::cerr) && run_stream(program, StreamOptions::from_args(), std::cout, std::cerr);
+	}
+
+	// Syntax errors in bodies which are parsed lazily fail the run once it is
+	// done, e.g. the dumps parse the bodies which have not been evaluated.
+	ok = ast->report_lazy_errors(std::cerr) && ok;
+	{
+		const PhaseTimer timer{stats, "teardown"};
+		ast.reset();
+	}
+
+	return ok;
 }
 
-static void run_interactive_mode(){
+static bool run_interactive_mode(Stats* const stats){
 	std::string code{};
 	std::getline(std::cin, code, ';');
 
 	std::cout << '\n';
-	interpret(code);
+	return interpret(code, stats);
 }
 
-static void run_filename_mode(){
+static bool run_filename_mode(Stats* const stats){
 	std::string code{};
 	std::ifstream file{args.filename};
 
 	if(file){
-		std::getline(file, code, '\0');
-		interpret(code);
-	}else
+		{
+			const PhaseTimer timer{stats, "read"};
+			std::getline(file, code, '\0');
+		}
+
+		return interpret(code, stats);
+	}else{
 		std::cerr << "error: Invalid filename \'" << args.filename << "\'.\n";
+		return false;
+	}
 }
 
 int main(int argc, const char* argv[]){
 	parse_args(argc, argv);
-	if(args.interactive_mode)
-		run_interactive_mode();
+
+	Stats stats{};
+	alloc_stats_enabled = args.stats;
+
+	bool ok{};
+	if(!args.serve_socket.empty())
+		ok = run_server();
+	else if(!args.program_id.empty())
+		ok = run_client(std::string{});
+	else if(args.interactive_mode)
+		ok = run_interactive_mode(args.stats ? &stats : nullptr);
 	else
-		run_filename_mode();
+		ok = run_filename_mode(args.stats ? &stats : nullptr);
+
+	if(args.stats)
+		stats.print(std::cerr, args.stats_json);
 
-	return 0;
+	return ok ? 0 : -1;
 }
\ No newline at end of file
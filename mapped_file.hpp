@@ -0,0 +1,101 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <ostream>
+
+#include <cerrno>
+#include <cstring>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A read-only memory mapping of a whole file.
+class MappedFile{
+	private:
+		const char* m_data;
+		size_t m_size;
+
+	public:
+		explicit MappedFile(): m_data{nullptr}, m_size{0}{
+		}
+
+		MappedFile(MappedFile&& other): m_data{other.m_data}, m_size{other.m_size}{
+			other.m_data = nullptr;
+			other.m_size = 0;
+		}
+
+		MappedFile& operator= (MappedFile&& other){
+			std::swap(this->m_data, other.m_data);
+			std::swap(this->m_size, other.m_size);
+
+			return *this;
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator= (const MappedFile&) = delete;
+
+		~MappedFile(){
+			if(this->m_data)
+				::munmap(const_cast<char*>(this->m_data), this->m_size);
+		}
+
+		// Reports errors to 'err', an empty file is mapped successfully.
+		static bool open(const std::string& path, MappedFile& file, std::ostream& err){
+			const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if(fd < 0){
+				MappedFile::report(err, path);
+				return false;
+			}
+
+			struct stat st{};
+			if(0 != ::fstat(fd, &st)){
+				MappedFile::report(err, path);
+				::close(fd);
+
+				return false;
+			}
+
+			MappedFile res{};
+			if(st.st_size > 0){
+				void* const data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if(MAP_FAILED == data){
+					MappedFile::report(err, path);
+					::close(fd);
+
+					return false;
+				}
+
+				res.m_data = static_cast<const char*>(data);
+				res.m_size = static_cast<size_t>(st.st_size);
+			}
+
+			::close(fd);
+
+			file = std::move(res);
+			return true;
+		}
+
+		// The file is read sequentially.
+		inline void advise_sequential()const{
+			if(this->m_data)
+				::madvise(const_cast<char*>(this->m_data), this->m_size, MADV_SEQUENTIAL);
+		}
+
+		inline std::string_view view()const{
+			return std::string_view{this->m_data, this->m_size};
+		}
+
+	private:
+		static void report(std::ostream& err, const std::string& path){
+			err << "error: Unable to map \'" << path << "\' (" << std::strerror(errno) << ").\n";
+		}
+};
+
+#endif	// MAPPED_FILE_HPP
\ No newline at end of file
@@ -0,0 +1,193 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include "ast_node.hpp"
+#include "sym_table.hpp"
+#include "exec_limits.hpp"
+
+// Runs the instructions of an instruction list concurrently where their
+// variables permit. Instruction j depends on an earlier instruction i if
+// one of them assigns a variable the other one reads or assigns.
+// Every instruction runs on a private symbol table which is seeded with
+// the values its variables have after its dependencies, and the private
+// tables are merged back in program order once all instructions are done.
+class ParallelExecutor{
+	private:
+		static constexpr size_t NONE = SIZE_MAX;
+
+		struct Task{
+			const BaseNode* instr;
+
+			VarSet reads;
+			VarSet writes;
+
+			// For every variable of the instruction the task which assigned it
+			// last, i.e. the task whose private table holds its current value.
+			std::vector<std::pair<std::string_view, size_t>> sources;
+
+			std::vector<size_t> successors;
+			uint32_t pending;
+
+			SymbolTable sym_table;
+		};
+
+		std::vector<Task> m_tasks;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::deque<size_t> m_ready;
+		size_t m_done;
+
+	public:
+		explicit ParallelExecutor(const InstrListNode& list):
+			m_tasks{}, m_mutex{}, m_cv{}, m_ready{}, m_done{0}{
+
+			this->m_tasks.reserve(list.instrs().size());
+			for(const auto& instr : list.instrs()){
+				this->m_tasks.push_back(Task{instr.get(), {}, {}, {}, {}, 0, SymbolTable{}});
+				instr->collect_vars(this->m_tasks.back().reads, this->m_tasks.back().writes);
+			}
+
+			this->build_graph();
+		}
+
+		void eval(SymbolTable& sym_table, const uint32_t thread_cnt){
+			for(size_t task_idx = 0; task_idx < this->m_tasks.size(); ++task_idx){
+				if(0 == this->m_tasks[task_idx].pending)
+					this->m_ready.push_back(task_idx);
+			}
+
+			std::vector<std::thread> workers{};
+			for(uint32_t i = 0; i < thread_cnt; ++i)
+				workers.emplace_back(&ParallelExecutor::work, this, std::cref(sym_table), exec_limits.budget());
+
+			for(auto& worker : workers)
+				worker.join();
+
+			this->merge(sym_table);
+		}
+
+	private:
+		void build_graph(){
+			std::unordered_map<std::string_view, size_t> last_writer{};
+			std::unordered_map<std::string_view, std::vector<size_t>> readers{};
+
+			const auto add_edge = [this](const size_t from, const size_t to){
+				if(from != NONE && from != to){
+					this->m_tasks[from].successors.push_back(to);
+					++this->m_tasks[to].pending;
+				}
+			};
+
+			for(size_t task_idx = 0; task_idx < this->m_tasks.size(); ++task_idx){
+				Task& task = this->m_tasks[task_idx];
+
+				VarSet vars{task.reads};
+				vars.insert(task.writes.cbegin(), task.writes.cend());
+
+				for(const auto& var : vars){
+					const auto writer = last_writer.find(var);
+					const size_t source = (writer != last_writer.end()) ? writer->second : NONE;
+
+					task.sources.emplace_back(var, source);
+					add_edge(source, task_idx);
+				}
+
+				for(const auto& var : task.writes){
+					auto& var_readers = readers[var];
+					for(const size_t reader : var_readers)
+						add_edge(reader, task_idx);
+
+					var_readers.clear();
+					last_writer[var] = task_idx;
+				}
+
+				for(const auto& var : task.reads){
+					if(0 == task.writes.count(var))
+						readers[var].push_back(task_idx);
+				}
+			}
+		}
+
+		void work(const SymbolTable& initial, ExecBudget* const budget){
+			const ExecLimitsGuard limits_guard{budget};
+
+			while(true){
+				size_t task_idx{};
+				{
+					std::unique_lock<std::mutex> lock{this->m_mutex};
+					this->m_cv.wait(lock, [this]{
+						return !this->m_ready.empty() || this->m_done == this->m_tasks.size();
+					});
+
+					if(this->m_ready.empty())
+						return;
+
+					task_idx = this->m_ready.front();
+					this->m_ready.pop_front();
+				}
+
+				// Once a limit is exceeded the remaining tasks are only retired.
+				if(!exec_limits.stopped())
+					this->run(task_idx, initial);
+
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					for(const size_t successor : this->m_tasks[task_idx].successors){
+						if(0 == --this->m_tasks[successor].pending)
+							this->m_ready.push_back(successor);
+					}
+
+					++this->m_done;
+				}
+
+				this->m_cv.notify_all();
+			}
+		}
+
+		// The sources of a task are its dependencies, hence their private
+		// tables are complete and no longer modified.
+		void run(const size_t task_idx, const SymbolTable& initial){
+			Task& task = this->m_tasks[task_idx];
+
+			for(const auto& source : task.sources){
+				const std::string var_name{source.first};
+				const SymbolTable& source_table = (source.second != NONE)
+					? this->m_tasks[source.second].sym_table
+					: initial;
+
+				// Variables which do not exist yet must not be created
+				// here, as reading them in the program would do so.
+				if(const Value* const value = source_table.find(var_name))
+					task.sym_table.update(var_name, *value);
+			}
+
+			task.instr->eval(task.sym_table);
+		}
+
+		void merge(SymbolTable& sym_table)const{
+			for(const auto& task : this->m_tasks){
+				for(const auto& entry : task.sym_table){
+					if(task.writes.count(entry.first) > 0)
+						sym_table.update(entry.first, entry.second);
+					else
+						sym_table.get_or_insert(entry.first);
+				}
+			}
+		}
+};
+
+#endif	// PARALLEL_HPP
\ No newline at end of file
@@ -1,7 +1,10 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <memory>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include <sstream>
 #include <iostream>
@@ -10,21 +13,166 @@
 
 #include "token.hpp"
 #include "lexer.hpp"
+#include "token_pipe.hpp"
 #include "ast_node.hpp"
+#include "shared_nodes.hpp"
+#include "lazy_node.hpp"
+#include "list_node.hpp"
+#include "import_node.hpp"
+#include "unit.hpp"
+#include "exec_limits.hpp"
 
 #include "args.hpp"
 #include "util.hpp"
 
 class Parser{
 	private:
+		const std::string& m_code;
+
 		Token m_token;
 		Lexer m_lexer;
 
+		// Tokens are read from the pipe instead of the lexer unless it is nullptr.
+		std::unique_ptr<TokenPipe> m_pipe;
+
 		mutable bool m_ok;
 
+		// Syntax errors are reported to 'm_errors' unless it is nullptr.
+		std::ostream* const m_errors;
+		const bool m_exit_on_error;
+
+		// Expressions are hash-consed unless it is nullptr.
+		std::unique_ptr<SharedNodes> m_shared_nodes;
+
+		// Bodies of branches and loops are parsed on first use unless it
+		// is nullptr, their syntax errors are collected, see LazyNode.
+		std::shared_ptr<LazyErrors> m_lazy_errors;
+
+		ImportChain m_chain;
+
+		// Every unit imported so far, directly or not.
+		std::vector<std::shared_ptr<const Unit>> m_units;
+
 	public:
 		explicit Parser(const std::string& code):
-			m_token{}, m_lexer{code}, m_ok{true}{
+			m_code{code},
+			m_token{},
+			m_lexer{code},
+			m_pipe{},
+			m_ok{true},
+			m_errors{&std::cerr},
+			m_exit_on_error{!args.try_recovery_from_syntax_errors},
+			m_shared_nodes{},
+			m_lazy_errors{},
+			m_chain{},
+			m_units{}{
+		}
+
+		// Reports syntax errors to 'errors' and never exits on them.
+		Parser(const std::string& code, std::ostream& errors):
+			m_code{code},
+			m_token{},
+			m_lexer{code, 0, static_cast<uint32_t>(code.size()), &errors},
+			m_pipe{},
+			m_ok{true},
+			m_errors{&errors},
+			m_exit_on_error{false},
+			m_shared_nodes{},
+			m_lazy_errors{},
+			m_chain{},
+			m_units{}{
+		}
+
+		// Parses code[begin, end) only, see parse_instrs().
+		// Syntax errors are neither reported nor exited on.
+		Parser(const std::string& code, const uint32_t begin, const uint32_t end):
+			Parser{code, begin, end, nullptr, false}{
+		}
+
+		// Parses code[begin, end) only, see parse_instr_list_only().
+		Parser(
+				const std::string& code,
+				const uint32_t begin,
+				const uint32_t end,
+				std::ostream* const errors,
+				const bool exit_on_error
+			):
+				m_code{code},
+				m_token{},
+				m_lexer{code, begin, end, errors},
+				m_pipe{},
+				m_ok{true},
+				m_errors{errors},
+				m_exit_on_error{exit_on_error},
+				m_shared_nodes{},
+				m_lazy_errors{},
+				m_chain{},
+				m_units{}{
+		}
+
+		// Parses an imported unit like 'importer' parses the program, but
+		// never lazily: the imports of the unit are resolved at once.
+		Parser(const Unit& unit, const Parser& importer, ImportChain chain):
+			Parser{unit.code, 0, static_cast<uint32_t>(unit.code.size()), importer.m_errors, importer.m_exit_on_error}{
+
+			this->m_chain = std::move(chain);
+			this->m_lexer.lines().set_source(unit.path);
+			if(importer.m_shared_nodes)
+				this->share_nodes();
+
+			// The lexer thread of the importer records concurrently.
+			LexStats* const stats = importer.m_lexer.stats();
+			if(stats && !stats->concurrent)
+				this->record_lexing(stats);
+		}
+
+		// Structurally identical expressions parsed from now on share their nodes.
+		inline void share_nodes(){
+			if(!this->m_shared_nodes)
+				this->m_shared_nodes = std::make_unique<SharedNodes>();
+		}
+
+		// Only the parentheses of the bodies of branches and loops are
+		// checked, the bodies are parsed on first use.
+		inline void parse_lazily(std::shared_ptr<LazyErrors> errors = std::make_shared<LazyErrors>()){
+			this->m_lazy_errors = std::move(errors);
+		}
+
+		// nullptr unless the bodies are parsed lazily. The errors have to
+		// be reported once the program is done, see LazyErrors.
+		inline std::shared_ptr<LazyErrors> lazy_errors()const{
+			return this->m_lazy_errors;
+		}
+
+		// Counts and times the tokens, see --stats.
+		inline void record_lexing(LexStats* const stats){
+			this->m_lexer.record(stats);
+		}
+
+		// Lexes the whole code on a thread of its own, see TokenPipe. Only for
+		// parsers of the whole code which do not parse lazily, since skipping
+		// the bodies of branches and loops takes the lexer.
+		inline void lex_concurrently(){
+			this->m_pipe = std::make_unique<TokenPipe>(this->m_code, this->m_lexer);
+		}
+
+		// Unless the bodies are parsed lazily, these are all units of the program.
+		inline const std::vector<std::shared_ptr<const Unit>>& units()const{
+			return this->m_units;
+		}
+
+		// The shared nodes have to outlive the parsed nodes.
+		inline std::unique_ptr<SharedNodes> release_shared_nodes(){
+			return std::move(this->m_shared_nodes);
+		}
+
+		inline bool ok()const{
+			return this->m_ok && this->m_lexer.ok();
+		}
+
+		// Like ok(), but invalid characters, which are skipped, do not count.
+		inline bool syntax_ok()const{
+			return this->m_ok;
 		}
 
 		BaseNode* parse(){
@@ -35,6 +183,28 @@ class Parser{
 			return root;
 		}
 
+		// Used to parse the body of a LazyNode.
+		BaseNode* parse_instr_list_only(){
+			this->read_next_token();
+			BaseNode* const list = this->parse_instr_list();
+			this->expect(TokenType::CONTR_EOF);
+
+			return list;
+		}
+
+		// instrs ::= {instr};
+		// Used to reparse a part of an instruction list, the caller owns
+		// the nodes even if the parser is not ok() afterwards.
+		std::vector<BaseNode*> parse_instrs(){
+			std::vector<BaseNode*> instrs{};
+
+			this->read_next_token();
+			while(this->m_token != TokenType::CONTR_EOF && this->ok())
+				instrs.push_back(this->parse_instr());
+
+			return instrs;
+		}
+
 	private:
 		// start ::= instr_list;
 		inline BaseNode* parse_start(){
@@ -57,11 +227,13 @@ class Parser{
 					this->read_next_token();
 			}
 
+			list->set_end(this->m_token.pos().offset() + 1);
 			this->expect_and_read(TokenType::R_PAR);
+
 			return list;
 		}
 
-		// instr ::= '(' (assign | cond | loop) ')';
+		// instr ::= '(' (assign | cond | loop | import) ')';
 		BaseNode* parse_instr(){
 			BaseNode* ret{};
 
@@ -76,6 +248,12 @@ class Parser{
 				case TokenType::WHILE:
 					ret = this->parse_loop();
 					break;
+				case TokenType::IDENT:
+					if(IMPORT_SV == this->m_token.value()){
+						ret = this->parse_import();
+						break;
+					}
+					[[fallthrough]];
 				default:
 					this->expect(
 						TokenType::SET,
@@ -118,8 +296,8 @@ class Parser{
 			this->read_next_token();
 
 			BaseNode* const condition = this->parse_exp();
-			BaseNode* const if_branch = this->parse_instr_list();
-			BaseNode* const else_branch = this->parse_instr_list();
+			BaseNode* const if_branch = this->parse_body();
+			BaseNode* const else_branch = this->parse_body();
 
 			return new IfNode{condition, if_branch, else_branch, pos};
 		}
@@ -132,14 +310,67 @@ class Parser{
 			this->read_next_token();
 
 			BaseNode* const condition = this->parse_exp();
-			BaseNode* const loop = this->parse_instr_list();
+			BaseNode* const loop = this->parse_body();
 
 			return new WhileNode{condition, loop, pos};
 		}
 
+		// import ::= 'import' ident;
+		BaseNode* parse_import(){
+			const TokenPosition pos = this->m_token.pos();
+
+			this->read_next_token();
+			if(this->m_token != TokenType::IDENT){
+				this->expect(TokenType::IDENT);
+				return new ErrorNode{pos};
+			}
+
+			const std::string_view name = this->m_token.value();
+			this->read_next_token();
+
+			std::ostringstream errors{};
+			const std::shared_ptr<const Unit> unit = Unit::load(name, errors);
+			ImportChain chain{this->m_chain};
+			if(!unit || !chain.enter(*unit, errors)){
+				if(this->m_errors)
+					*this->m_errors << errors.str();
+				if(this->m_exit_on_error)
+					std::exit(-1);
+
+				this->m_ok = false;
+				return new ErrorNode{pos};
+			}
+
+			Parser parser{*unit, *this, std::move(chain)};
+			BaseNode* const body = parser.parse();
+			if(!parser.ok())
+				this->m_ok = false;
+
+			this->m_units.push_back(unit);
+			this->m_units.insert(this->m_units.end(), parser.m_units.begin(), parser.m_units.end());
+
+			return new ImportNode{unit, body, parser.release_shared_nodes(), pos};
+		}
+
+		// Falls back to parse_instr_list() if the body is not lazy or
+		// its parentheses are unbalanced, i.e. it cannot be skipped.
+		BaseNode* parse_body(){
+			if(!this->m_lazy_errors || this->m_token != TokenType::L_PAR)
+				return this->parse_instr_list();
+
+			const TokenPosition pos = this->m_token.pos();
+			uint32_t end{};
+			if(!this->m_lexer.skip_balanced(end))
+				return this->parse_instr_list();
+
+			this->read_next_token();
+			return new LazyNode{this->m_code, pos, end, this->m_lazy_errors};
+		}
+
 		// exp ::= integer | ident | '(' arith_exp ')';
 		// ident	::= ('a' | ... | 'z') {'a' | ... | 'z' | '0' | ... | '9'};
 		// integer	::= '0' | (('1' | ... | '9') {'0' | ... | '9'});
+		// A missing expression is an ErrorNode, which evaluates to 0 if recovering.
 		BaseNode* parse_exp(){
 			BaseNode* ret{};
 			const TokenPosition pos = this->m_token.pos();
@@ -167,16 +398,27 @@ class Parser{
 						TokenType::IDENT,
 						TokenType::L_PAR
 					);
+
+					return new ErrorNode{pos};
 			}
 
+			if(this->m_shared_nodes)
+				ret = this->m_shared_nodes->intern(ret);
+
 			return ret;
 		}
 
-		// arith_exp ::= ('add' | 'sub' | 'mul') exp exp;
+		// arith_exp ::= ('add' | 'sub' | 'mul') exp exp | list_exp;
 		BaseNode* parse_arith_exp(){
 			const TokenPosition pos = this->m_token.pos();
 			const TokenType arith_type = this->m_token.type();
 
+			if(this->m_token == TokenType::IDENT){
+				const auto list_op = list_op_table.find(this->m_token.value());
+				if(list_op != list_op_table.end())
+					return this->parse_list_exp(list_op->second);
+			}
+
 			this->expect_and_read(TokenType::ADD, TokenType::SUB, TokenType::MUL);
 
 			BaseNode* const param1 = this->parse_exp();
@@ -190,31 +432,61 @@ class Parser{
 				case TokenType::MUL:
 					return new MulNode{param1, param2, pos};
 				default:
-					delete param1; delete param2;
+					NodeDeleter{}(param1); NodeDeleter{}(param2);
 					return new ErrorNode{pos};
 			}
 		}
 
+		// list_exp ::= 'list' {exp} | ('range' | 'len' | 'sum' | 'prod' | 'max') exp | 'at' exp exp;
+		BaseNode* parse_list_exp(const NodeKind kind){
+			const TokenPosition pos = this->m_token.pos();
+
+			this->debug_expect(TokenType::IDENT);
+			this->read_next_token();
+
+			const size_t arity = ListOpNode::arity(kind);
+
+			// Like the operands of arith_exp, a missing operand is reported by parse_exp().
+			std::vector<NodePtr> params{};
+			if(0 != arity){
+				while(params.size() < arity)
+					params.emplace_back(this->parse_exp());
+			}else{
+				while(this->m_token != TokenType::R_PAR && this->m_token != TokenType::CONTR_EOF){
+					params.emplace_back(this->parse_exp());
+					if(NodeKind::ERROR == params.back()->kind())
+						break;
+				}
+			}
+
+			if(std::any_of(params.begin(), params.end(), [](const NodePtr& param){ return NodeKind::ERROR == param->kind(); }))
+				return new ErrorNode{pos};
+
+			return new ListOpNode{kind, std::move(params), pos};
+		}
+
 		template <typename... T>
 		bool expect(const T... tt)const{
 			static_assert(sizeof...(T) > 0);
 
 			if(((this->m_token != tt) && ...)){
-				std::ostringstream oss{};
-				oss << "error[parser, " << this->m_token.pos() << "]: "
-					<< "Invalid token " << this->m_token.name()
-					<< " (";
+				if(this->m_errors){
+					std::ostringstream oss{};
+					oss << "error[parser, " << this->m_lexer.lines().locate(this->m_token.pos()) << "]: "
+						<< "Invalid token " << this->m_token.name()
+						<< " (";
 
-				print_list(oss, token_type_name(tt)...);
-				oss << " expected).\n";
+					print_list(oss, token_type_name(tt)...);
+					oss << " expected).\n";
 
-				std::cerr << oss.str();
+					*this->m_errors << oss.str();
+				}
 
-				if(args.try_recovery_from_syntax_errors){
-					this->m_ok = false;
-					return false;
-				}else
+				if(this->m_exit_on_error)
 					std::exit(-1);
+
+				this->m_ok = false;
+				return false;
 			}
 
 			return true;
@@ -234,8 +506,36 @@ class Parser{
 		}
 
 		inline void read_next_token(){
-			this->m_lexer.read_next_token(this->m_token);
+			if(this->m_pipe)
+				this->m_pipe->read_next_token(this->m_token);
+			else
+				this->m_lexer.read_next_token(this->m_token);
 		}
 };
 
+// Nested bodies are parsed lazily as well. Unless the recovery from syntax
+// errors is tried, a list with syntax errors is replaced by an erroneous
+// instruction, since the evaluation may be in the middle of a loop.
+inline void LazyNode::parse()const{
+	std::ostringstream errors{};
+	Parser parser{this->m_code, this->m_pos.offset(), this->m_end, &errors, false};
+
+	parser.parse_lazily(this->m_errors);
+	this->m_node.reset(parser.parse_instr_list_only());
+
+	if(parser.ok())
+		return;
+
+	const bool fatal = !parser.syntax_ok() && !args.try_recovery_from_syntax_errors;
+	this->m_errors->add(errors.str(), fatal);
+	if(!fatal)
+		return;
+
+	InstrListNode* const list = new InstrListNode{this->m_pos};
+	list->add(new ErrorNode{this->m_pos});
+	this->m_node.reset(list);
+
+	exec_limits.stop(LimitType::SYNTAX_ERROR);
+}
+
 #endif	// PARSER_HPP
\ No newline at end of file
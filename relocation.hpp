@@ -0,0 +1,64 @@
+#ifndef RELOCATION_HPP
+#define RELOCATION_HPP
+
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "token_position.hpp"
+
+// Describes how positions and views into the source code move when
+// code[offset, old_end) is replaced and the code is moved to a new buffer.
+// Only positions in front of or behind the replaced range can be relocated.
+class Relocation{
+	private:
+		const char* m_old_base;
+		size_t m_old_size;
+		const char* m_new_base;
+
+		uint32_t m_begin;
+		uint32_t m_old_end;
+		int64_t m_delta;
+
+	public:
+		Relocation(
+				const std::string_view& old_code,
+				const std::string_view& new_code,
+				const uint32_t begin,
+				const uint32_t old_end,
+				const uint32_t new_end
+			):
+				m_old_base{old_code.data()},
+				m_old_size{old_code.size()},
+				m_new_base{new_code.data()},
+				m_begin{begin},
+				m_old_end{old_end},
+				m_delta{static_cast<int64_t>(new_end) - old_end}{
+		}
+
+		// If the code stays in its buffer, nodes in front of the
+		// replaced range do not have to be visited at all.
+		inline bool skips(const uint32_t end)const{
+			return this->m_old_base == this->m_new_base && end <= this->m_begin;
+		}
+
+		uint32_t apply(const uint32_t offset)const{
+			return (offset < this->m_old_end) ? offset : static_cast<uint32_t>(offset + this->m_delta);
+		}
+
+		inline TokenPosition apply(const TokenPosition& pos)const{
+			return TokenPosition{this->apply(pos.offset())};
+		}
+
+		// Views which do not point into the old code (e.g. names of temporaries) stay untouched.
+		std::string_view apply(const std::string_view& sv)const{
+			if(sv.data() < this->m_old_base || sv.data() >= this->m_old_base + this->m_old_size)
+				return sv;
+
+			const uint32_t offset = static_cast<uint32_t>(sv.data() - this->m_old_base);
+			return std::string_view{this->m_new_base + this->apply(offset), sv.size()};
+		}
+};
+
+#endif	// RELOCATION_HPP
\ No newline at end of file
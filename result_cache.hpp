@@ -0,0 +1,186 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <filesystem>
+#include <system_error>
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#include <string>
+#include <string_view>
+
+#include <fstream>
+#include <sstream>
+#include <ostream>
+
+#include <cstdint>
+
+#include "atomic_file.hpp"
+#include "sym_table.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+// Stores the final symbol tables of programs within a directory. Programs
+// have no input, hence the table only depends on the normalized program.
+// Entries are named by the hash of the program and hold the normalized
+// program, which has to match, since hashes may collide.
+//
+// Entries are written atomically, so readers (even in other processes) never
+// see a partially written entry. Once the entries exceed the size limit, the
+// least recently used ones are evicted.
+// The cache is best effort: an entry which cannot be read is a miss and an
+// entry which cannot be written is only reported.
+class ResultCache{
+	private:
+		static constexpr std::string_view MAGIC_SV{"theoLISP-result-2"};
+		static constexpr std::string_view ENTRY_EXT_SV{".result"};
+
+		const std::filesystem::path m_dir;
+		const uint64_t m_max_bytes;
+
+	public:
+		// A limit of 0 disables the eviction.
+		ResultCache(const std::string& dir, const uint64_t max_bytes):
+			m_dir{dir}, m_max_bytes{max_bytes}{
+		}
+
+		inline bool enabled()const{
+			return !this->m_dir.empty();
+		}
+
+		// Replaces the content of 'sym_table' if the entry of 'program' exists.
+		bool load(const uint64_t key, const std::string& program, SymbolTable& sym_table)const{
+			const std::filesystem::path path = this->entry_path(key);
+
+			std::ifstream file{path, std::ios::binary};
+			if(!file)
+				return false;
+
+			std::string magic{};
+			std::string stored_key{};
+			size_t entry_cnt{};
+			size_t program_size{};
+			if(!(file >> magic >> stored_key >> entry_cnt >> program_size)
+				|| MAGIC_SV != magic
+				|| to_hex(key) != stored_key
+				|| program.size() != program_size){
+
+				return false;
+			}
+
+			std::vector<std::pair<std::string, IntType>> entries{};
+			entries.reserve(entry_cnt);
+
+			std::string name{};
+			IntType value{};
+			while(entries.size() < entry_cnt && file >> name >> value)
+				entries.emplace_back(std::move(name), value);
+
+			if(entries.size() != entry_cnt)
+				return false;
+
+			// The program follows the line of the last entry.
+			std::string stored_program(program_size, '\0');
+			if(!file.ignore(1).read(stored_program.data(), static_cast<std::streamsize>(program_size)) || program != stored_program)
+				return false;
+
+			// Inserting in reverse restores the order of the dump.
+			SymbolTable table{};
+			for(auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+				table.update(entry->first, entry->second);
+
+			sym_table = std::move(table);
+
+			// The modification time orders the entries for the eviction.
+			std::error_code ec{};
+			std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+			return true;
+		}
+
+		// Only tables of integers are stored.
+		void store(const uint64_t key, const std::string& program, const SymbolTable& sym_table, std::ostream& err)const{
+			if(sym_table.holds_lists())
+				return;
+
+			std::error_code ec{};
+			std::filesystem::create_directories(this->m_dir, ec);
+			if(ec){
+				this->report(err, ec);
+				return;
+			}
+
+			std::ostringstream entry{};
+			entry << MAGIC_SV << ' ' << to_hex(key) << ' ' << std::distance(sym_table.begin(), sym_table.end()) << ' ' << program.size() << '\n';
+			for(const auto& elem : sym_table)
+				entry << elem.first << ' ' << elem.second << '\n';
+
+			entry << program;
+
+			if(!write_file_atomically(this->entry_path(key), entry.str(), ec)){
+				this->report(err, ec);
+				return;
+			}
+
+			this->evict();
+		}
+
+	private:
+		inline std::filesystem::path entry_path(const uint64_t key)const{
+			return this->m_dir / (to_hex(key) + std::string{ENTRY_EXT_SV});
+		}
+
+		void report(std::ostream& err, const std::error_code& ec)const{
+			err << "warning: Unable to store the result in \'" << this->m_dir.string() << "\' (" << ec.message() << ").\n";
+		}
+
+		// Entries which vanish concurrently are simply skipped.
+		void evict()const{
+			if(0 == this->m_max_bytes)
+				return;
+
+			struct Entry{
+				std::filesystem::path path;
+				std::filesystem::file_time_type time;
+				uint64_t size;
+			};
+
+			std::vector<Entry> entries{};
+			uint64_t total = 0;
+
+			std::error_code ec{};
+			for(std::filesystem::directory_iterator it{this->m_dir, ec}, end{}; !ec && it != end; it.increment(ec)){
+				if(it->path().extension() != ENTRY_EXT_SV)
+					continue;
+
+				std::error_code size_ec{};
+				std::error_code time_ec{};
+				const uint64_t size = it->file_size(size_ec);
+				const auto time = it->last_write_time(time_ec);
+				if(size_ec || time_ec)
+					continue;
+
+				entries.push_back(Entry{it->path(), time, size});
+				total += size;
+			}
+
+			if(total <= this->m_max_bytes)
+				return;
+
+			std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+				return a.time < b.time;
+			});
+
+			for(const Entry& entry : entries){
+				if(total <= this->m_max_bytes)
+					break;
+
+				if(std::filesystem::remove(entry.path, ec))
+					total -= entry.size;
+			}
+		}
+};
+
+#endif	// RESULT_CACHE_HPP
\ No newline at end of file
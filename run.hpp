@@ -0,0 +1,189 @@
+#ifndef RUN_HPP
+#define RUN_HPP
+
+#include <string>
+#include <sstream>
+#include <ostream>
+
+#include <cstdint>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "exec_limits.hpp"
+#include "result_cache.hpp"
+#include "checkpoint.hpp"
+#include "stats.hpp"
+#include "types.hpp"
+#include "value.hpp"
+
+#include "args.hpp"
+
+struct RunOptions{
+	bool optimize = false;
+
+	bool dump_ast = false;
+	bool dump_sym_table = false;
+	bool dump_temps = false;
+	bool dump_ranges = false;
+	bool pythonify = false;
+
+	uint32_t threads = 1;
+
+	uint64_t max_steps = 0;
+	uint32_t timeout_ms = 0;
+
+	// Evaluates on the VM if either is given.
+	std::string checkpoint_file{};
+	uint32_t checkpoint_interval_s = 60;
+	std::string resume_file{};
+
+	// Disabled if empty, the limit is given in MiB.
+	std::string cache_dir{};
+	uint32_t cache_dir_limit = 0;
+
+	static RunOptions from_args(){
+		RunOptions opts{};
+		opts.optimize = args.optimize;
+		opts.dump_ast = args.dump_ast;
+		opts.dump_sym_table = args.dump_sym_table;
+		opts.dump_temps = args.dump_temps;
+		opts.dump_ranges = args.dump_ranges;
+		opts.pythonify = args.pythonify;
+		opts.threads = args.threads;
+		opts.max_steps = args.max_steps;
+		opts.timeout_ms = args.timeout_ms;
+		opts.checkpoint_file = args.checkpoint_file;
+		opts.checkpoint_interval_s = args.checkpoint_interval_s;
+		opts.resume_file = args.resume_file;
+		opts.cache_dir = args.cache_dir;
+		opts.cache_dir_limit = args.cache_dir_limit;
+
+		return opts;
+	}
+};
+
+// Writes the result of an evaluation and the requested dumps to 'out'. If an
+// execution limit was exceeded, the limit and the symbol table as far as the
+// evaluation got are written to 'err' instead and false is returned. 'ast' is
+// only used for the dumps and pythonify, i.e. may be nullptr otherwise.
+static bool write_results(
+		const Ast* const ast,
+		const RunOptions& opts,
+		SymbolTable& sym_table,
+		const ExecBudget& budget,
+		std::ostream& out,
+		std::ostream& err
+	){
+
+	const Value res = sym_table.get_value_or_insert("result");
+
+	if(ast)
+		ast->report_lazy_errors(err);
+
+	if(LimitType::NONE != budget.exceeded()){
+		std::ostringstream oss{};
+		budget.report(oss);
+		sym_table.dump(oss << '\n', opts.dump_temps);
+
+		err << oss.str();
+		return false;
+	}
+
+	std::ostringstream oss{};
+	oss << "-> " << res << '\n';
+
+	if(opts.dump_ast)
+		ast->dump(oss << '\n');
+
+	if(opts.dump_sym_table)
+		sym_table.dump(oss << '\n', opts.dump_temps);
+
+	if(opts.dump_ranges)
+		ast->dump_ranges(oss << '\n', opts.dump_temps);
+
+	if(opts.pythonify)
+		ast->pythonify(oss << '\n');
+
+	out << oss.str();
+	return true;
+}
+
+// Evaluates the program and writes its result and the requested dumps to 'out'.
+// If an execution limit is exceeded, the limit and the symbol table as far as
+// the evaluation got are written to 'err' instead and false is returned.
+// With a cache directory, the evaluation is skipped if the symbol table of the
+// program is cached. Only complete evaluations are cached.
+static bool run_program(
+		const Ast& ast,
+		const RunOptions& opts,
+		std::ostream& out,
+		std::ostream& err,
+		Stats* const stats = nullptr
+	){
+
+	SymbolTable sym_table{};
+
+	const ResultCache cache{opts.cache_dir, uint64_t{opts.cache_dir_limit} << 20};
+	const uint64_t key = cache.enabled() ? ast.hash() : 0;
+	const std::string program = cache.enabled() ? ast.normalized() : std::string{};
+
+	ExecBudget budget{opts.max_steps, opts.timeout_ms};
+
+	// The bodies parsed lazily so far, e.g. for the hash, have to be free of syntax errors.
+	if(!ast.lazy_ok())
+		budget.cancel(LimitType::SYNTAX_ERROR);
+
+	if(!cache.enabled() || !cache.load(key, program, sym_table)){
+		{
+			const PhaseTimer timer{stats, "eval"};
+			const ExecLimitsGuard limits_guard{&budget};
+			const Watchdog watchdog{budget};
+
+			if(opts.checkpoint_file.empty() && opts.resume_file.empty())
+				ast.eval(sym_table, opts.threads);
+			else if(eval_resumable(ast.compile(), sym_table, opts.checkpoint_file, opts.checkpoint_interval_s, opts.resume_file, err))
+				sym_table.get_or_insert("result");
+			else
+				return false;
+		}
+
+		if(cache.enabled() && LimitType::NONE == budget.exceeded())
+			cache.store(key, program, sym_table, err);
+	}
+
+	if(stats)
+		stats->record_sym_table(sym_table);
+
+	return write_results(&ast, opts, sym_table, budget, out, err);
+}
+
+// Like run_program() for a program without AST, see BytecodeParser. The
+// program is evaluated on the VM and neither dumped nor cached.
+static bool run_compiled(
+		const Program& program,
+		const RunOptions& opts,
+		std::ostream& out,
+		std::ostream& err,
+		Stats* const stats = nullptr
+	){
+
+	SymbolTable sym_table{};
+
+	ExecBudget budget{opts.max_steps, opts.timeout_ms};
+	{
+		const PhaseTimer timer{stats, "eval"};
+		const ExecLimitsGuard limits_guard{&budget};
+		const Watchdog watchdog{budget};
+
+		if(!eval_resumable(program, sym_table, opts.checkpoint_file, opts.checkpoint_interval_s, opts.resume_file, err))
+			return false;
+	}
+
+	if(stats)
+		stats->record_sym_table(sym_table);
+
+	return write_results(nullptr, opts, sym_table, budget, out, err);
+}
+
+#endif	// RUN_HPP
\ No newline at end of file
@@ -0,0 +1,200 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <map>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include <cstdint>
+
+#include "vm.hpp"
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "exec_limits.hpp"
+
+// Multiplexes many programs on a few threads. A task runs on the VM for a
+// slice of a fixed number of loop iterations and is put back into the run
+// queue afterwards, hence a long running loop never starves other tasks.
+//
+// The queue is ordered by stride scheduling: the pass of a task advances by
+// STRIDE / priority per slice and the task with the smallest pass runs next,
+// i.e. the tasks share the threads in proportion to their priorities. A new
+// task starts at the pass of the task started last, so it neither has to
+// catch up with nor is overtaken by the tasks which are already running.
+class Scheduler{
+	public:
+		// Called on a thread of the scheduler once the task halted or exceeded
+		// one of its limits, the table holds the variables like after eval().
+		using Callback = std::function<void(SymbolTable& sym_table, const ExecBudget& budget)>;
+
+		static constexpr uint32_t MAX_PRIORITY = 1000;
+
+	private:
+		static constexpr uint64_t STRIDE = uint64_t{1} << 20;
+
+		struct Task{
+			const std::shared_ptr<const Program> program;
+			VM vm;
+
+			// The timeout is checked in front of every slice, not by a watchdog.
+			ExecBudget budget;
+			const std::chrono::steady_clock::time_point deadline;
+
+			const uint32_t priority;
+			uint64_t pass;
+
+			const Callback done;
+
+			Task(
+					std::shared_ptr<const Program> program_,
+					const uint32_t priority_,
+					const uint64_t max_steps,
+					const uint32_t timeout_ms,
+					const uint64_t pass_,
+					Callback done_
+				):
+					program{std::move(program_)},
+					vm{*program},
+					budget{max_steps, timeout_ms},
+					deadline{(0 == timeout_ms)
+						? std::chrono::steady_clock::time_point::max()
+						: std::chrono::steady_clock::now() + std::chrono::milliseconds{timeout_ms}},
+					priority{std::clamp(priority_, 1u, Scheduler::MAX_PRIORITY)},
+					pass{pass_},
+					done{std::move(done_)}{
+			}
+		};
+
+		const uint32_t m_slice;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::condition_variable m_idle_cv;
+
+		std::multimap<uint64_t, std::unique_ptr<Task>> m_queue;
+		uint64_t m_pass;
+		size_t m_pending;
+		bool m_stopping;
+
+		std::vector<std::thread> m_threads;
+
+	public:
+		// 'slice' is the number of loop iterations of a time slice.
+		Scheduler(const uint32_t thread_cnt, const uint32_t slice):
+			m_slice{std::max(slice, 1u)},
+			m_mutex{},
+			m_cv{},
+			m_idle_cv{},
+			m_queue{},
+			m_pass{0},
+			m_pending{0},
+			m_stopping{false},
+			m_threads{}{
+
+			for(uint32_t i = 0; i < std::max(thread_cnt, 1u); ++i)
+				this->m_threads.emplace_back(&Scheduler::work, this);
+		}
+
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator= (const Scheduler&) = delete;
+
+		// Pending tasks are finished first.
+		~Scheduler(){
+			{
+				std::lock_guard<std::mutex> lock{this->m_mutex};
+				this->m_stopping = true;
+			}
+
+			this->m_cv.notify_all();
+			for(auto& thread : this->m_threads)
+				thread.join();
+		}
+
+		// Priorities range from 1 to MAX_PRIORITY, limits of 0 mean unlimited.
+		void submit(
+				std::shared_ptr<const Program> program,
+				const uint32_t priority,
+				const uint64_t max_steps,
+				const uint32_t timeout_ms,
+				Callback done
+			){
+
+			{
+				std::lock_guard<std::mutex> lock{this->m_mutex};
+
+				auto task = std::make_unique<Task>(std::move(program), priority, max_steps, timeout_ms, this->m_pass, std::move(done));
+				this->m_queue.emplace(task->pass, std::move(task));
+				++this->m_pending;
+			}
+
+			this->m_cv.notify_one();
+		}
+
+		// Blocks until every submitted task is done.
+		void wait(){
+			std::unique_lock<std::mutex> lock{this->m_mutex};
+			this->m_idle_cv.wait(lock, [this]{ return 0 == this->m_pending; });
+		}
+
+	private:
+		void work(){
+			while(true){
+				std::unique_ptr<Task> task{};
+				{
+					std::unique_lock<std::mutex> lock{this->m_mutex};
+					this->m_cv.wait(lock, [this]{ return this->m_stopping || !this->m_queue.empty(); });
+
+					if(this->m_queue.empty())
+						return;
+
+					const auto next = this->m_queue.begin();
+					task = std::move(next->second);
+					this->m_queue.erase(next);
+
+					this->m_pass = task->pass;
+				}
+
+				if(VMStatus::YIELDED == this->run_slice(*task)){
+					{
+						std::lock_guard<std::mutex> lock{this->m_mutex};
+
+						task->pass += Scheduler::STRIDE / task->priority;
+						this->m_queue.emplace(task->pass, std::move(task));
+					}
+
+					this->m_cv.notify_one();
+					continue;
+				}
+
+				SymbolTable sym_table{};
+				task->vm.store(sym_table);
+				task->done(sym_table, task->budget);
+				task.reset();
+
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					--this->m_pending;
+				}
+
+				this->m_idle_cv.notify_all();
+			}
+		}
+
+		VMStatus run_slice(Task& task)const{
+			if(std::chrono::steady_clock::now() >= task.deadline)
+				task.budget.cancel(LimitType::TIMEOUT);
+
+			const ExecLimitsGuard limits_guard{&task.budget};
+			return task.vm.run_slice(this->m_slice);
+		}
+};
+
+#endif	// SCHEDULER_HPP
\ No newline at end of file
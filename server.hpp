@@ -0,0 +1,391 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <list>
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include <cstdint>
+
+#include "ast.hpp"
+#include "run.hpp"
+#include "parser.hpp"
+#include "unit.hpp"
+#include "unix_socket.hpp"
+#include "scheduler.hpp"
+#include "exec_limits.hpp"
+#include "result_cache.hpp"
+#include "bytecode.hpp"
+
+#include "args.hpp"
+#include "util.hpp"
+
+// The source code together with the AST which refers to it and its bytecode.
+class CompiledProgram{
+	private:
+		const std::string m_code;
+		const bool m_optimize;
+
+		std::string m_errors;
+		std::unique_ptr<Ast> m_ast;
+		Program m_program;
+
+		std::vector<std::shared_ptr<const Unit>> m_units;
+
+	public:
+		CompiledProgram(std::string code, const bool optimize):
+			m_code{std::move(code)}, m_optimize{optimize}, m_errors{}, m_ast{}, m_program{}, m_units{}{
+
+			std::ostringstream errors{};
+			Parser parser{this->m_code, errors};
+
+			this->m_ast = std::make_unique<Ast>(parser.parse(), this->m_code);
+			if(optimize && parser.ok())
+				this->m_ast->optimize();
+
+			this->m_units = parser.units();
+			this->m_errors = errors.str();
+			if(this->ok())
+				this->m_program = this->m_ast->compile();
+		}
+
+		inline bool ok()const{
+			return this->m_errors.empty();
+		}
+
+		inline bool compiled_from(const std::string& code, const bool optimize)const{
+			return this->m_optimize == optimize && this->m_code == code;
+		}
+
+		// Set if an imported unit has changed since.
+		bool outdated()const{
+			return std::any_of(this->m_units.begin(), this->m_units.end(), [](const std::shared_ptr<const Unit>& unit){
+				return unit->changed();
+			});
+		}
+
+		inline const std::string& code()const{
+			return this->m_code;
+		}
+
+		inline const std::string& errors()const{
+			return this->m_errors;
+		}
+
+		inline const Ast& ast()const{
+			return *this->m_ast;
+		}
+
+		inline const Program& program()const{
+			return this->m_program;
+		}
+};
+
+// Least recently used programs are evicted first.
+class ProgramCache{
+	private:
+		using Entry = std::pair<uint64_t, std::shared_ptr<const CompiledProgram>>;
+
+		std::mutex m_mutex;
+		std::list<Entry> m_lru;
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+
+		const size_t m_capacity;
+
+	public:
+		explicit ProgramCache(const size_t capacity):
+			m_mutex{}, m_lru{}, m_index{}, m_capacity{capacity}{
+		}
+
+		static uint64_t key(const std::string& code, const bool optimize){
+			return fnv1a(optimize ? "O" : "-", fnv1a(code));
+		}
+
+		std::shared_ptr<const CompiledProgram> find(const uint64_t key){
+			std::lock_guard<std::mutex> lock{this->m_mutex};
+
+			const auto res = this->m_index.find(key);
+			if(res == this->m_index.end())
+				return nullptr;
+
+			// Programs are compiled again once one of their units has changed.
+			if(res->second->second->outdated()){
+				this->m_lru.erase(res->second);
+				this->m_index.erase(res);
+
+				return nullptr;
+			}
+
+			this->m_lru.splice(this->m_lru.begin(), this->m_lru, res->second);
+			return res->second->second;
+		}
+
+		// Compiling happens outside of the lock, so a program might be compiled
+		// twice if it is requested concurrently, of which one copy is dropped.
+		// The key is no cryptographic hash, hence a program whose key is taken
+		// by another program is compiled but not cached. 'cached' is set if the
+		// program can be found by its key afterwards.
+		std::shared_ptr<const CompiledProgram> compile(const uint64_t key, std::string code, const bool optimize, bool& cached){
+			std::shared_ptr<const CompiledProgram> known = this->find(key);
+			cached = known && known->compiled_from(code, optimize);
+			if(cached)
+				return known;
+
+			auto program = std::make_shared<const CompiledProgram>(std::move(code), optimize);
+			if(known || !program->ok() || 0 == this->m_capacity)
+				return program;
+
+			std::lock_guard<std::mutex> lock{this->m_mutex};
+			const auto res = this->m_index.find(key);
+			if(res != this->m_index.end()){
+				cached = res->second->second->compiled_from(program->code(), optimize);
+				return program;
+			}
+
+			cached = true;
+			this->m_lru.emplace_front(key, program);
+			this->m_index.emplace(key, this->m_lru.begin());
+
+			if(this->m_lru.size() > this->m_capacity){
+				this->m_index.erase(this->m_lru.back().first);
+				this->m_lru.pop_back();
+			}
+
+			return program;
+		}
+};
+
+// Keeps compiled programs resident and serves the requests of the clients.
+// A request either carries the source code or the id of a program compiled
+// by an earlier request. Worker threads read and compile the requests, the
+// evaluations are multiplexed by a Scheduler, which answers the clients once
+// their programs are done. Hence the number of concurrent evaluations is not
+// limited by the number of threads.
+class Server{
+	private:
+		// Clients which do not send their request in time are dropped, so they
+		// cannot block a worker.
+		static constexpr uint32_t REQUEST_TIMEOUT_MS = 1000;
+
+		UnixSocket m_listener;
+		ProgramCache m_cache;
+
+		const uint32_t m_worker_cnt;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::deque<UnixSocket> m_clients;
+
+		Scheduler m_scheduler;
+
+	public:
+		// The scheduler runs on as many threads as there are workers.
+		Server(UnixSocket listener, const size_t cache_size, const uint32_t worker_cnt, const uint32_t slice):
+			m_listener{std::move(listener)},
+			m_cache{cache_size},
+			m_worker_cnt{worker_cnt},
+			m_mutex{},
+			m_cv{},
+			m_clients{},
+			m_scheduler{worker_cnt, slice}{
+		}
+
+		// Runs until the process is terminated.
+		void serve(){
+			std::vector<std::thread> workers{};
+			for(uint32_t i = 0; i < this->m_worker_cnt; ++i)
+				workers.emplace_back(&Server::work, this);
+
+			while(true){
+				UnixSocket client = this->m_listener.accept();
+				if(!client.valid())
+					continue;
+
+				client.set_timeout(Server::REQUEST_TIMEOUT_MS);
+
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					this->m_clients.push_back(std::move(client));
+				}
+
+				this->m_cv.notify_one();
+			}
+		}
+
+	private:
+		void work(){
+			while(true){
+				UnixSocket client{};
+				{
+					std::unique_lock<std::mutex> lock{this->m_mutex};
+					this->m_cv.wait(lock, [this]{ return !this->m_clients.empty(); });
+
+					client = std::move(this->m_clients.front());
+					this->m_clients.pop_front();
+				}
+
+				Message request{};
+				if(client.read(request, uint64_t{args.max_request_size} << 20))
+					this->handle(std::move(client), request);
+			}
+		}
+
+		// Limits of the server are the defaults of the requests.
+		void handle(UnixSocket client, const Message& request){
+			RunOptions opts{};
+			opts.optimize = request.get_flag("optimize");
+			opts.dump_ast = request.get_flag("dump-ast");
+			opts.dump_sym_table = request.get_flag("dump-sym");
+			opts.dump_temps = request.get_flag("dump-temps");
+			opts.dump_ranges = request.get_flag("dump-ranges");
+			opts.pythonify = request.get_flag("pythonify");
+			opts.max_steps = request.get_uint("max-steps", args.max_steps);
+			opts.timeout_ms = static_cast<uint32_t>(request.get_uint("timeout", args.timeout_ms));
+			opts.cache_dir = args.cache_dir;
+			opts.cache_dir_limit = args.cache_dir_limit;
+
+			const uint32_t priority = static_cast<uint32_t>(request.get_uint("priority", 1));
+
+			Message response{};
+			std::shared_ptr<const CompiledProgram> program{};
+
+			const std::string id = request.get("program");
+			if(!id.empty()){
+				program = this->m_cache.find(std::strtoull(id.c_str(), nullptr, 16));
+				if(!program){
+					response.set("status", "error");
+					response.set_body("error: Unknown program \'" + id + "\'.\n");
+					client.write(response);
+					return;
+				}
+
+				response.set("program", id);
+			}else{
+				if(request.body().size() > MAX_CODE_SIZE){
+					response.set("status", "error");
+					response.set_body("error: The program is larger than " + std::to_string(MAX_CODE_SIZE) + " bytes.\n");
+					client.write(response);
+					return;
+				}
+
+				const uint64_t key = ProgramCache::key(request.body(), opts.optimize);
+
+				bool cached{};
+				program = this->m_cache.compile(key, request.body(), opts.optimize, cached);
+
+				if(!program->ok()){
+					response.set("status", "error");
+					response.set_body(program->errors());
+					client.write(response);
+					return;
+				}
+
+				if(cached)
+					response.set("program", to_hex(key));
+			}
+
+			// Estimating the cost replaces the evaluation, e.g. to decide where to run the program.
+			if(request.get_flag("estimate-cost")){
+				std::ostringstream out{};
+				program->ast().estimate_cost(out);
+
+				response.set("status", "ok");
+				response.set_body(out.str());
+				client.write(response);
+				return;
+			}
+
+			const ResultCache cache{opts.cache_dir, uint64_t{opts.cache_dir_limit} << 20};
+			const uint64_t key = cache.enabled() ? program->ast().hash() : 0;
+
+			SymbolTable sym_table{};
+			if(cache.enabled() && cache.load(key, program->ast().normalized(), sym_table)){
+				const ExecBudget budget{};
+				Server::respond(client, response, *program, opts, sym_table, budget);
+				return;
+			}
+
+			// The VM only knows integers, hence programs using lists are evaluated on the worker.
+			if(!program->program().supported()){
+				ExecBudget budget{opts.max_steps, opts.timeout_ms};
+				{
+					const ExecLimitsGuard limits_guard{&budget};
+					const Watchdog watchdog{budget};
+					program->ast().eval(sym_table);
+				}
+
+				Server::respond(client, response, *program, opts, sym_table, budget);
+				return;
+			}
+
+			// The callback has to be copyable, hence the socket is shared.
+			const auto shared_client = std::make_shared<UnixSocket>(std::move(client));
+			this->m_scheduler.submit(
+				std::shared_ptr<const Program>{program, &program->program()},
+				priority,
+				opts.max_steps,
+				opts.timeout_ms,
+				[shared_client, response, program, opts, key](SymbolTable& sym_table, const ExecBudget& budget){
+					sym_table.get_or_insert("result");
+
+					std::ostringstream err{};
+					const ResultCache cache{opts.cache_dir, uint64_t{opts.cache_dir_limit} << 20};
+					if(cache.enabled() && LimitType::NONE == budget.exceeded())
+						cache.store(key, program->ast().normalized(), sym_table, err);
+
+					Message res = response;
+					res.set_body(err.str());
+					Server::respond(*shared_client, res, *program, opts, sym_table, budget);
+				}
+			);
+		}
+
+		// Appends the results to the body of the response.
+		static void respond(
+				UnixSocket& client,
+				Message& response,
+				const CompiledProgram& program,
+				const RunOptions& opts,
+				SymbolTable& sym_table,
+				const ExecBudget& budget
+			){
+
+			std::ostringstream out{};
+			out << response.body();
+
+			const bool ok = write_results(&program.ast(), opts, sym_table, budget, out, out);
+
+			response.set("status", ok ? "ok" : "error");
+			response.set_body(out.str());
+
+			client.write(response);
+		}
+};
+
+static bool run_server(){
+	UnixSocket listener = UnixSocket::listen(args.serve_socket, std::cerr);
+	if(!listener.valid())
+		return false;
+
+	uint32_t worker_cnt = args.workers;
+	if(0 == worker_cnt)
+		worker_cnt = std::max(1u, std::thread::hardware_concurrency());
+
+	Server server{std::move(listener), args.cache_size, worker_cnt, args.slice};
+	server.serve();
+
+	return true;
+}
+
+#endif	// SERVER_HPP
\ No newline at end of file
@@ -0,0 +1,124 @@
+#ifndef SHARED_NODES_HPP
+#define SHARED_NODES_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include <string_view>
+
+#include <cstdint>
+
+#include "ast_node.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+// Hash-consing of expressions: structurally identical expressions share a
+// single node, which keeps the position of the first occurrence. Children
+// are interned before their parents, hence arithmetic nodes are compared
+// by the identity of their children and a lookup takes constant time.
+class SharedNodes{
+	private:
+		struct Key{
+			NodeKind kind;
+			IntType value;
+			std::string_view var_name;
+			const BaseNode* param1;
+			const BaseNode* param2;
+
+			inline bool operator== (const Key& other)const{
+				return this->kind == other.kind
+					&& this->value == other.value
+					&& this->var_name == other.var_name
+					&& this->param1 == other.param1
+					&& this->param2 == other.param2;
+			}
+		};
+
+		struct KeyHash{
+			size_t operator()(const Key& key)const{
+				uint64_t res = KeyHash::hash_bytes(key.kind, FNV_OFFSET_BASIS);
+				res = KeyHash::hash_bytes(key.value, res);
+				res = fnv1a(key.var_name, res);
+				res = KeyHash::hash_bytes(key.param1, res);
+
+				return static_cast<size_t>(KeyHash::hash_bytes(key.param2, res));
+			}
+
+			template <typename T>
+			static inline uint64_t hash_bytes(const T& value, const uint64_t seed){
+				return fnv1a(std::string_view{reinterpret_cast<const char*>(&value), sizeof(T)}, seed);
+			}
+		};
+
+		std::unordered_map<Key, BaseNode*, KeyHash> m_nodes;
+
+		// Owns the nodes, children precede their parents.
+		std::vector<BaseNode*> m_order;
+
+		uint64_t m_hits;
+
+	public:
+		explicit SharedNodes(): m_nodes{}, m_order{}, m_hits{0}{
+		}
+
+		SharedNodes(const SharedNodes&) = delete;
+		SharedNodes& operator= (const SharedNodes&) = delete;
+
+		// A parent tests its children for being shared, hence it is destroyed first.
+		~SharedNodes(){
+			for(auto it = this->m_order.rbegin(); it != this->m_order.rend(); ++it)
+				delete *it;
+		}
+
+		// Takes the ownership of 'node' and returns the node which replaces
+		// it. Nodes other than expressions whose children are shared (e.g.
+		// after syntax errors) are returned as they are.
+		BaseNode* intern(BaseNode* const node){
+			Key key{node->kind(), IntType{}, {}, nullptr, nullptr};
+			switch(node->kind()){
+				case NodeKind::INT:
+					key.value = static_cast<const IntNode*>(node)->value();
+					break;
+				case NodeKind::VAR:
+					key.var_name = static_cast<const VarNode*>(node)->var_name();
+					break;
+				case NodeKind::ADD:
+				case NodeKind::SUB:
+				case NodeKind::MUL:
+					key.param1 = static_cast<const ArithNode*>(node)->param1();
+					key.param2 = static_cast<const ArithNode*>(node)->param2();
+
+					if(!key.param1 || !key.param1->shared() || !key.param2 || !key.param2->shared())
+						return node;
+
+					break;
+				default:
+					return node;
+			}
+
+			const auto res = this->m_nodes.try_emplace(key, node);
+			if(!res.second){
+				++this->m_hits;
+				delete node;
+
+				return res.first->second;
+			}
+
+			node->m_shared = true;
+			this->m_order.push_back(node);
+
+			return node;
+		}
+
+		// Number of distinct shared nodes.
+		inline size_t size()const{
+			return this->m_nodes.size();
+		}
+
+		// Number of occurrences which reuse a shared node.
+		inline uint64_t hits()const{
+			return this->m_hits;
+		}
+};
+
+#endif	// SHARED_NODES_HPP
\ No newline at end of file
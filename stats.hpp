@@ -0,0 +1,236 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <string>
+#include <iomanip>
+#include <ostream>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/resource.h>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "token.hpp"
+#include "lexer.hpp"
+#include "ast_node.hpp"
+#include "sym_table.hpp"
+#include "alloc_stats.hpp"
+
+struct PhaseStats{
+	const char* name;
+	double ms;
+
+	uint64_t alloc_cnt;
+	uint64_t alloc_bytes;
+};
+
+// Statistics of a single run, see --stats.
+class Stats{
+	private:
+		std::vector<PhaseStats> m_phases;
+
+		LexStats m_lex;
+
+		// A program without AST is reported by its instructions instead of its nodes.
+		NodeCounts m_nodes;
+		InstrCounts m_instrs;
+		bool m_compiled;
+
+		size_t m_sym_table_size;
+		size_t m_sym_table_buckets;
+		float m_sym_table_load_factor;
+
+	public:
+		explicit Stats():
+			m_phases{},
+			m_lex{},
+			m_nodes{},
+			m_instrs{},
+			m_compiled{false},
+			m_sym_table_size{0},
+			m_sym_table_buckets{0},
+			m_sym_table_load_factor{0.0f}{
+		}
+
+		inline void add_phase(const PhaseStats& phase){
+			this->m_phases.push_back(phase);
+		}
+
+		// The lexer runs interleaved with the parser and records its tokens and
+		// time here, only those of the last parse are kept. See separate_lexing().
+		inline LexStats* lexing(){
+			this->m_lex = LexStats{};
+			return &this->m_lex;
+		}
+
+		// Reports the time of the lexer as 'lex' in front of the last phase, the
+		// parse, which is reduced by it unless the lexer ran concurrently.
+		void separate_lexing(){
+			PhaseStats parse = this->m_phases.back();
+			this->m_phases.pop_back();
+
+			const double lex_ms = this->m_lex.ms();
+			if(!this->m_lex.concurrent)
+				parse.ms = std::max(parse.ms - lex_ms, 0.0);
+
+			this->m_phases.push_back(PhaseStats{"lex", lex_ms, 0, 0});
+			this->m_phases.push_back(parse);
+		}
+
+		inline void count_nodes(const Ast& ast){
+			ast.count_nodes(this->m_nodes);
+		}
+
+		inline void count_instrs(const Program& program){
+			program.count_instrs(this->m_instrs);
+			this->m_compiled = true;
+		}
+
+		void record_sym_table(const SymbolTable& sym_table){
+			this->m_sym_table_size = sym_table.size();
+			this->m_sym_table_buckets = sym_table.bucket_count();
+			this->m_sym_table_load_factor = sym_table.load_factor();
+		}
+
+		void print(std::ostream& os, const bool json)const{
+			if(json)
+				this->print_json(os);
+			else
+				this->print_text(os);
+		}
+
+	private:
+		// In KiB.
+		static long peak_rss(){
+			rusage usage{};
+			return (0 == ::getrusage(RUSAGE_SELF, &usage)) ? usage.ru_maxrss : 0;
+		}
+
+		template <size_t N>
+		static uint64_t total(const std::array<uint64_t, N>& counts){
+			uint64_t res = 0;
+			for(const uint64_t cnt : counts)
+				res += cnt;
+
+			return res;
+		}
+
+		void print_text(std::ostream& os)const{
+			const AllocCounts allocs = alloc_counts();
+
+			os << "Stats:\n"
+			   << " phases:\n" << std::fixed << std::setprecision(3);
+
+			for(const PhaseStats& phase : this->m_phases){
+				os << "  " << phase.name << ": " << phase.ms << " ms ("
+				   << phase.alloc_cnt << " allocations, " << phase.alloc_bytes << " bytes)\n";
+			}
+
+			os << " tokens: " << Stats::total(this->m_lex.tokens) << '\n';
+			for(size_t i = 0; i < TOKEN_TYPE_CNT; ++i){
+				if(0 != this->m_lex.tokens[i])
+					os << "  " << token_type_names[i] << ": " << this->m_lex.tokens[i] << '\n';
+			}
+
+			if(this->m_compiled){
+				os << " instructions: " << Stats::total(this->m_instrs) << '\n';
+				for(size_t i = 0; i < OP_CODE_CNT; ++i){
+					if(0 != this->m_instrs[i])
+						os << "  " << op_code_names[i] << ": " << this->m_instrs[i] << '\n';
+				}
+			}else{
+				os << " nodes: " << Stats::total(this->m_nodes) << '\n';
+				for(size_t i = 0; i < NODE_KIND_CNT; ++i){
+					if(0 != this->m_nodes[i])
+						os << "  " << node_kind_names[i] << ": " << this->m_nodes[i] << '\n';
+				}
+			}
+
+			os << " sym table: " << this->m_sym_table_size << " entries, "
+			   << this->m_sym_table_buckets << " buckets, load factor " << this->m_sym_table_load_factor << '\n'
+			   << " allocations: " << allocs.cnt << " (" << allocs.bytes << " bytes)\n"
+			   << " peak rss: " << Stats::peak_rss() << " KiB\n";
+		}
+
+		void print_json(std::ostream& os)const{
+			const AllocCounts allocs = alloc_counts();
+
+			os << '{' << std::fixed << std::setprecision(3);
+
+			os << "\"phases\":[";
+			for(size_t i = 0; i < this->m_phases.size(); ++i){
+				const PhaseStats& phase = this->m_phases[i];
+				os << (0 == i ? "" : ",")
+				   << "{\"name\":\"" << phase.name << "\",\"ms\":" << phase.ms
+				   << ",\"allocations\":" << phase.alloc_cnt << ",\"alloc_bytes\":" << phase.alloc_bytes << '}';
+			}
+
+			os << "],\"tokens\":{\"total\":" << Stats::total(this->m_lex.tokens);
+			for(size_t i = 0; i < TOKEN_TYPE_CNT; ++i)
+				os << ",\"" << token_type_names[i] << "\":" << this->m_lex.tokens[i];
+
+			if(this->m_compiled){
+				os << "},\"instructions\":{\"total\":" << Stats::total(this->m_instrs);
+				for(size_t i = 0; i < OP_CODE_CNT; ++i)
+					os << ",\"" << op_code_names[i] << "\":" << this->m_instrs[i];
+			}else{
+				os << "},\"nodes\":{\"total\":" << Stats::total(this->m_nodes);
+				for(size_t i = 0; i < NODE_KIND_CNT; ++i)
+					os << ",\"" << node_kind_names[i] << "\":" << this->m_nodes[i];
+			}
+
+			os << "},\"sym_table\":{\"size\":" << this->m_sym_table_size
+			   << ",\"buckets\":" << this->m_sym_table_buckets
+			   << ",\"load_factor\":" << this->m_sym_table_load_factor
+			   << "},\"allocations\":{\"count\":" << allocs.cnt << ",\"bytes\":" << allocs.bytes
+			   << "},\"peak_rss_kib\":" << Stats::peak_rss() << "}\n";
+		}
+};
+
+// Adds the wall time and the allocations of its scope as a phase,
+// does nothing without statistics.
+class PhaseTimer{
+	private:
+		Stats* const m_stats;
+		const char* const m_name;
+
+		std::chrono::steady_clock::time_point m_start;
+		AllocCounts m_allocs;
+
+	public:
+		PhaseTimer(Stats* const stats, const char* const name):
+			m_stats{stats}, m_name{name}, m_start{}, m_allocs{}{
+
+			if(this->m_stats){
+				this->m_allocs = alloc_counts();
+				this->m_start = std::chrono::steady_clock::now();
+			}
+		}
+
+		PhaseTimer(const PhaseTimer&) = delete;
+		PhaseTimer& operator= (const PhaseTimer&) = delete;
+
+		~PhaseTimer(){
+			if(!this->m_stats)
+				return;
+
+			const auto end = std::chrono::steady_clock::now();
+			const AllocCounts allocs = alloc_counts();
+
+			this->m_stats->add_phase(PhaseStats{
+				this->m_name,
+				std::chrono::duration<double, std::milli>(end - this->m_start).count(),
+				allocs.cnt - this->m_allocs.cnt,
+				allocs.bytes - this->m_allocs.bytes
+			});
+		}
+};
+
+#endif	// STATS_HPP
\ No newline at end of file
@@ -0,0 +1,464 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <vector>
+#include <charconv>
+#include <algorithm>
+
+#include <string>
+#include <string_view>
+#include <ostream>
+
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#include "vm.hpp"
+#include "bytecode.hpp"
+#include "line_index.hpp"
+#include "mapped_file.hpp"
+#include "exec_limits.hpp"
+#include "types.hpp"
+
+#include "args.hpp"
+
+struct StreamOptions{
+	std::string input_file{};
+	RecordFormat format = RecordFormat::CSV;
+
+	// For CSV and TSV the names are read from the header line if empty.
+	std::vector<std::string> columns{};
+	std::vector<std::string> outputs{};
+
+	uint32_t threads = 1;
+
+	uint64_t max_steps = 0;
+	uint32_t timeout_ms = 0;
+
+	static StreamOptions from_args(){
+		StreamOptions opts{};
+		opts.input_file = args.input_file;
+		opts.format = args.input_format;
+		opts.columns = args.input_columns;
+		opts.outputs = args.output_vars;
+		opts.threads = args.threads;
+		opts.max_steps = args.max_steps;
+		opts.timeout_ms = args.timeout_ms;
+
+		return opts;
+	}
+};
+
+// Runs a program once per record of the input. Before every run the columns of
+// the record are bound to the variables of the same name, all other variables
+// start at 0 as usual. The output variables of every run are written as a
+// record of the same format (with a header line for CSV and TSV).
+//
+// The input is split into chunks which are evaluated in parallel, every thread
+// reuses a single VM. The outputs of the chunks are written in input order,
+// at most WINDOW_PER_THREAD chunks per thread are buffered. The outputs of all
+// records in front of the first malformed one are written, independent of the
+// number of threads.
+class RecordStream{
+	private:
+		static constexpr size_t CHUNK_BYTES = size_t{1} << 20;
+		static constexpr size_t WINDOW_PER_THREAD = 4;
+
+		struct Chunk{
+			size_t begin;
+			size_t end;
+
+			std::string output;
+
+			// Set once the chunk is processed or its first malformed record is found.
+			bool done;
+			size_t error_offset;
+			std::string error;
+		};
+
+		const Program& m_program;
+		const StreamOptions& m_opts;
+		const std::string_view m_input;
+
+		// The slot of every column and every output variable, NO_SLOT if the program does not use it.
+		std::vector<uint32_t> m_columns;
+		std::vector<uint32_t> m_outputs;
+
+		std::vector<Chunk> m_chunks;
+		ExecBudget& m_budget;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		size_t m_next;
+		size_t m_written;
+
+		// Set once the execution limits are exceeded, no more chunks are processed.
+		bool m_stopped;
+
+		// Set once a malformed record is found, no more chunks are started.
+		bool m_invalid;
+
+	public:
+		RecordStream(const Program& program, const StreamOptions& opts, const std::string_view& input, ExecBudget& budget):
+			m_program{program},
+			m_opts{opts},
+			m_input{input},
+			m_columns{},
+			m_outputs{},
+			m_chunks{},
+			m_budget{budget},
+			m_mutex{},
+			m_cv{},
+			m_next{0},
+			m_written{0},
+			m_stopped{false},
+			m_invalid{false}{
+		}
+
+		bool run(std::ostream& out, std::ostream& err){
+			size_t data_begin = 0;
+			if(!this->bind(data_begin, err) || !this->split(data_begin, err))
+				return false;
+
+			if(RecordFormat::INT64 != this->m_opts.format){
+				const char delim = this->delimiter();
+				for(size_t i = 0; i < this->m_opts.outputs.size(); ++i){
+					if(0 != i)
+						out << delim;
+
+					out << this->m_opts.outputs[i];
+				}
+
+				out << '\n';
+			}
+
+			const uint32_t thread_cnt = (0 == this->m_opts.threads) ? 1 : this->m_opts.threads;
+			const size_t window = WINDOW_PER_THREAD * thread_cnt;
+
+			std::vector<std::thread> workers{};
+			for(uint32_t i = 0; i < thread_cnt; ++i)
+				workers.emplace_back(&RecordStream::work, this, window);
+
+			// Every chunk in front of the first malformed record is processed,
+			// since the chunks are started in input order.
+			const Chunk* invalid = nullptr;
+			for(Chunk& chunk : this->m_chunks){
+				{
+					std::unique_lock<std::mutex> lock{this->m_mutex};
+					this->m_cv.wait(lock, [this, &chunk]{ return chunk.done || this->m_stopped; });
+
+					if(!chunk.done)
+						break;
+				}
+
+				out.write(chunk.output.data(), static_cast<std::streamsize>(chunk.output.size()));
+				std::string{}.swap(chunk.output);
+
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					++this->m_written;
+				}
+
+				this->m_cv.notify_all();
+
+				if(!chunk.error.empty()){
+					invalid = &chunk;
+					break;
+				}
+			}
+
+			for(std::thread& worker : workers)
+				worker.join();
+
+			out.flush();
+
+			if(invalid)
+				this->report(*invalid, err);
+
+			return !this->m_stopped && !invalid;
+		}
+
+	private:
+		// Offsets which do not fit a TokenPosition are reported as they are.
+		void report(const Chunk& chunk, std::ostream& err)const{
+			err << "error[input, ";
+
+			if(RecordFormat::INT64 == this->m_opts.format || chunk.error_offset > UINT32_MAX)
+				err << "offset: " << chunk.error_offset;
+			else
+				err << LineIndex{this->m_input}.locate(TokenPosition{static_cast<uint32_t>(chunk.error_offset)});
+
+			err << "]: " << chunk.error << '\n';
+		}
+
+		inline char delimiter()const{
+			return (RecordFormat::TSV == this->m_opts.format) ? '\t' : ',';
+		}
+
+		// Maps the columns and the output variables to slots.
+		bool bind(size_t& data_begin, std::ostream& err){
+			std::vector<std::string> columns = this->m_opts.columns;
+
+			if(columns.empty()){
+				if(RecordFormat::INT64 == this->m_opts.format){
+					err << "error: The columns of int64 input have to be named by --columns.\n";
+					return false;
+				}
+
+				// The header line.
+				const size_t header_end = std::min(this->m_input.find('\n'), this->m_input.size());
+				std::string_view header = this->m_input.substr(0, header_end);
+				if(!header.empty() && '\r' == header.back())
+					header.remove_suffix(1);
+
+				data_begin = (header_end < this->m_input.size()) ? header_end + 1 : header_end;
+
+				size_t field_begin = 0;
+				while(true){
+					const size_t field_end = std::min(header.find(this->delimiter(), field_begin), header.size());
+					columns.emplace_back(header.substr(field_begin, field_end - field_begin));
+
+					if(field_end == header.size())
+						break;
+
+					field_begin = field_end + 1;
+				}
+			}
+
+			for(const std::string& column : columns)
+				this->m_columns.push_back(this->m_program.find_slot(column));
+
+			for(const std::string& output : this->m_opts.outputs)
+				this->m_outputs.push_back(this->m_program.find_slot(output));
+
+			return true;
+		}
+
+		// Chunks of text end behind a newline, chunks of int64 records behind a record.
+		bool split(const size_t data_begin, std::ostream& err){
+			const size_t size = this->m_input.size();
+
+			if(RecordFormat::INT64 == this->m_opts.format){
+				const size_t record_size = this->m_columns.size() * sizeof(IntType);
+				if(0 != size % record_size){
+					err << "error[input]: The size of \'" << this->m_opts.input_file
+						<< "\' is no multiple of the record size (" << record_size << " bytes).\n";
+					return false;
+				}
+
+				const size_t chunk_size = std::max(CHUNK_BYTES / record_size, size_t{1}) * record_size;
+				for(size_t begin = 0; begin < size; begin += chunk_size)
+					this->m_chunks.push_back(Chunk{begin, std::min(begin + chunk_size, size), std::string{}, false, 0, std::string{}});
+
+				return true;
+			}
+
+			size_t begin = data_begin;
+			while(begin < size){
+				size_t end = std::min(begin + CHUNK_BYTES, size);
+				if(end < size){
+					const size_t newline = this->m_input.find('\n', end - 1);
+					end = (std::string_view::npos == newline) ? size : newline + 1;
+				}
+
+				this->m_chunks.push_back(Chunk{begin, end, std::string{}, false, 0, std::string{}});
+				begin = end;
+			}
+
+			return true;
+		}
+
+		void work(const size_t window){
+			const ExecLimitsGuard limits_guard{&this->m_budget};
+			VM vm{this->m_program};
+
+			while(true){
+				size_t idx{};
+				{
+					std::unique_lock<std::mutex> lock{this->m_mutex};
+					this->m_cv.wait(lock, [this, window]{
+						return this->m_stopped
+							|| this->m_invalid
+							|| this->m_next >= this->m_chunks.size()
+							|| this->m_next < this->m_written + window;
+					});
+
+					if(this->m_stopped || this->m_invalid || this->m_next >= this->m_chunks.size())
+						return;
+
+					idx = this->m_next++;
+				}
+
+				Chunk& chunk = this->m_chunks[idx];
+
+				size_t error_offset{};
+				std::string error{};
+				const bool ok = (RecordFormat::INT64 == this->m_opts.format)
+					? this->process_binary(chunk, vm)
+					: this->process_text(chunk, vm, error_offset, error);
+
+				{
+					std::lock_guard<std::mutex> lock{this->m_mutex};
+					if(ok || !error.empty()){
+						// The outputs of the records in front of a malformed one are kept.
+						chunk.done = true;
+						chunk.error_offset = error_offset;
+						chunk.error = std::move(error);
+
+						this->m_invalid = this->m_invalid || !chunk.error.empty();
+					}else
+						this->m_stopped = true;
+				}
+
+				this->m_cv.notify_all();
+			}
+		}
+
+		bool process_text(Chunk& chunk, VM& vm, size_t& error_offset, std::string& error)const{
+			const char delim = this->delimiter();
+			const char* const data = this->m_input.data();
+
+			const char* it = data + chunk.begin;
+			const char* const end = data + chunk.end;
+
+			char buffer[24];
+			while(it < end){
+				const char* line_end = static_cast<const char*>(std::memchr(it, '\n', static_cast<size_t>(end - it)));
+				const char* const next = line_end ? line_end + 1 : end;
+
+				if(!line_end)
+					line_end = end;
+				if(line_end > it && '\r' == line_end[-1])
+					--line_end;
+
+				// Blank lines are skipped.
+				if(it == line_end){
+					it = next;
+					continue;
+				}
+
+				vm.reset();
+
+				size_t column = 0;
+				const char* field = it;
+				while(true){
+					const char* field_end = static_cast<const char*>(std::memchr(field, delim, static_cast<size_t>(line_end - field)));
+					if(!field_end)
+						field_end = line_end;
+
+					IntType value{};
+					if(column >= this->m_columns.size() || !RecordStream::parse_int(field, field_end, value)){
+						error_offset = static_cast<size_t>(it - data);
+						error = (column >= this->m_columns.size())
+							? "Too many fields, " + std::to_string(this->m_columns.size()) + " expected."
+							: "Invalid integer \'" + std::string{field, field_end} + "\'.";
+
+						return false;
+					}
+
+					if(NO_SLOT != this->m_columns[column])
+						vm.set_slot(this->m_columns[column], value);
+
+					++column;
+					if(field_end == line_end)
+						break;
+
+					field = field_end + 1;
+				}
+
+				if(column != this->m_columns.size()){
+					error_offset = static_cast<size_t>(it - data);
+					error = "Too few fields, " + std::to_string(this->m_columns.size()) + " expected.";
+
+					return false;
+				}
+
+				if(!vm.run())
+					return false;
+
+				for(size_t i = 0; i < this->m_outputs.size(); ++i){
+					if(0 != i)
+						chunk.output += delim;
+
+					const IntType value = (NO_SLOT != this->m_outputs[i]) ? vm.slot(this->m_outputs[i]) : IntType{};
+					const auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+					chunk.output.append(buffer, res.ptr);
+				}
+
+				chunk.output += '\n';
+				it = next;
+			}
+
+			return true;
+		}
+
+		bool process_binary(Chunk& chunk, VM& vm)const{
+			const char* const data = this->m_input.data();
+			const size_t record_size = this->m_columns.size() * sizeof(IntType);
+
+			chunk.output.reserve((chunk.end - chunk.begin) / record_size * this->m_outputs.size() * sizeof(IntType));
+			for(size_t record = chunk.begin; record < chunk.end; record += record_size){
+				vm.reset();
+
+				for(size_t column = 0; column < this->m_columns.size(); ++column){
+					if(NO_SLOT == this->m_columns[column])
+						continue;
+
+					IntType value{};
+					std::memcpy(&value, data + record + column * sizeof(IntType), sizeof(IntType));
+					vm.set_slot(this->m_columns[column], value);
+				}
+
+				if(!vm.run())
+					return false;
+
+				for(const uint32_t output : this->m_outputs){
+					const IntType value = (NO_SLOT != output) ? vm.slot(output) : IntType{};
+					chunk.output.append(reinterpret_cast<const char*>(&value), sizeof(IntType));
+				}
+			}
+
+			return true;
+		}
+
+		// An empty field is 0, a sign is allowed.
+		static bool parse_int(const char* first, const char* const last, IntType& value){
+			if(first == last)
+				return true;
+
+			if('+' == *first)
+				++first;
+
+			const auto res = std::from_chars(first, last, value);
+			return std::errc{} == res.ec && last == res.ptr;
+		}
+};
+
+static bool run_stream(const Program& program, const StreamOptions& opts, std::ostream& out, std::ostream& err){
+	MappedFile input{};
+	if(!MappedFile::open(opts.input_file, input, err))
+		return false;
+
+	input.advise_sequential();
+
+	if(!program.supported()){
+		err << "error: Programs using lists cannot process a stream (--input).\n";
+		return false;
+	}
+
+	ExecBudget budget{opts.max_steps, opts.timeout_ms};
+	const Watchdog watchdog{budget};
+
+	RecordStream stream{program, opts, input.view(), budget};
+	if(stream.run(out, err))
+		return true;
+
+	budget.report(err);
+	return false;
+}
+
+#endif	// STREAM_HPP
\ No newline at end of file
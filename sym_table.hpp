@@ -5,18 +5,33 @@
 
 #include <string>
 #include <ostream>
+#include <utility>
+
+#include <cstddef>
 
 #include "types.hpp"
+#include "value.hpp"
+#include "util.hpp"
+#include "args.hpp"
 
 class SymbolTable{
 	private:
-		std::unordered_map<std::string, IntType> m_table;
+		std::unordered_map<std::string, Value> m_table;
+
+		// Set once a list is stored and never reset.
+		bool m_holds_lists;
 
 	public:
-		explicit SymbolTable(): m_table{}{
+		explicit SymbolTable(): m_table{}, m_holds_lists{false}{
 		}
 
+		// A list counts as its length, see Value::as_int().
 		inline IntType get_or_insert(const std::string& symbol){
+			return this->m_table[symbol].as_int();
+		}
+
+		// The reference is valid until the next insertion.
+		inline const Value& get_value_or_insert(const std::string& symbol){
 			return this->m_table[symbol];
 		}
 
@@ -24,10 +39,51 @@ class SymbolTable{
 			this->m_table[symbol] = value;
 		}
 
-		void dump(std::ostream& os)const{
+		inline void update(const std::string& symbol, Value value){
+			this->m_holds_lists |= value.is_list();
+			this->m_table[symbol] = std::move(value);
+		}
+
+		// Without lists, every value is an integer.
+		inline bool holds_lists()const{
+			return this->m_holds_lists;
+		}
+
+		// Unlike get_or_insert() this does not insert missing symbols.
+		inline const Value* find(const std::string& symbol)const{
+			const auto res = this->m_table.find(symbol);
+			return (res != this->m_table.end()) ? &res->second : nullptr;
+		}
+
+		inline size_t size()const{
+			return this->m_table.size();
+		}
+
+		inline size_t bucket_count()const{
+			return this->m_table.bucket_count();
+		}
+
+		inline float load_factor()const{
+			return this->m_table.load_factor();
+		}
+
+		inline auto begin()const{
+			return this->m_table.cbegin();
+		}
+
+		inline auto end()const{
+			return this->m_table.cend();
+		}
+
+		// Temporaries of the optimizer are hidden unless requested.
+		void dump(std::ostream& os, const bool with_temps = args.dump_temps)const{
 			os << "SymTable:\n";
-			for(const auto& entry : this->m_table)
+			for(const auto& entry : this->m_table){
+				if(!with_temps && is_internal_name(entry.first))
+					continue;
+
 				os << ' ' << entry.first << ": " << entry.second << '\n';
+			}
 		}
 };
 
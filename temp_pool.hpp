@@ -0,0 +1,30 @@
+#ifndef TEMP_POOL_HPP
+#define TEMP_POOL_HPP
+
+#include <deque>
+
+#include <string>
+#include <string_view>
+
+#include "util.hpp"
+
+class TempPool{
+	private:
+		// std::deque never relocates its elements on insertion at the back,
+		// hence the views handed out by make() stay valid.
+		std::deque<std::string> m_names;
+
+	public:
+		explicit TempPool(): m_names{}{
+		}
+
+		std::string_view make(){
+			std::string name{INTERNAL_PREFIX_SV};
+			name += 't';
+			name += std::to_string(this->m_names.size());
+
+			return this->m_names.emplace_back(std::move(name));
+		}
+};
+
+#endif	// TEMP_POOL_HPP
\ No newline at end of file
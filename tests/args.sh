@@ -0,0 +1,26 @@
+#!/bin/sh
+# An option which takes a value fails without it instead of being taken for
+# the filename.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf '((set result 1))' > "$DIR/prog.tl"
+
+FAILED=0
+
+for OPT in --threads --max-steps --timeout --checkpoint --checkpoint-interval --resume --input \
+		--input-format --columns --outputs --cache-dir --cache-dir-limit --priority; do
+	if "$BIN" "$DIR/prog.tl" "$OPT" > /dev/null 2>&1; then
+		echo "FAILED: $OPT without a value"
+		FAILED=1
+	fi
+done
+
+if ! "$BIN" "$DIR/prog.tl" --threads 2 > /dev/null 2>&1; then
+	echo "FAILED: --threads 2"
+	FAILED=1
+fi
+
+exit $FAILED
@@ -0,0 +1,34 @@
+#!/bin/sh
+# A stopped evaluation continues from its checkpoint, a checkpoint whose pc is
+# not in front of a loop head is rejected.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf '((set i 10) (while i ((set i (sub i 1)) (set result (add result 3)))))' > "$DIR/loop.tl"
+
+FAILED=0
+
+"$BIN" "$DIR/loop.tl" --checkpoint "$DIR/loop.ckpt" --max-steps 4 > /dev/null 2>&1
+if [ ! -f "$DIR/loop.ckpt" ]; then
+	echo "FAILED: no checkpoint has been written"
+	exit 1
+fi
+
+OUT=$("$BIN" "$DIR/loop.tl" --resume "$DIR/loop.ckpt" 2>&1)
+if [ $? -ne 0 ] || [ "$OUT" != "-> 30" ]; then
+	echo "FAILED: resuming the checkpoint (output '$OUT')"
+	FAILED=1
+fi
+
+# Line 2 is '<pc> <slot count>', the loop head is behind the first assignment.
+for PC in 0 3 1000; do
+	sed "2s/^[0-9]* /$PC /" "$DIR/loop.ckpt" > "$DIR/bad.ckpt"
+	if "$BIN" "$DIR/loop.tl" --resume "$DIR/bad.ckpt" > /dev/null 2>&1; then
+		echo "FAILED: a checkpoint with pc $PC has been resumed"
+		FAILED=1
+	fi
+done
+
+exit $FAILED
@@ -0,0 +1,39 @@
+#!/bin/sh
+# A damaged compiled unit is a cache miss, the unit is compiled once more.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf '((set y (mul x 2)))' > "$DIR/lib.tl"
+printf '((set x 1) (import lib) (set result (add y 1)))' > "$DIR/main.tl"
+
+FAILED=0
+
+# Usage: expect_result <description>
+expect_result(){
+	OUT=$("$BIN" "$DIR/main.tl" 2>&1)
+	RES=$?
+
+	if [ "$RES" -ne 0 ] || [ "$OUT" != "-> 3" ]; then
+		echo "FAILED: $1 (exit code $RES, output '$OUT')"
+		FAILED=1
+	fi
+}
+
+expect_result "compiling the unit"
+expect_result "loading the compiled unit"
+
+if [ ! -f "$DIR/.tlcache/lib.tlc" ]; then
+	echo "FAILED: the unit has not been compiled"
+	exit 1
+fi
+
+# Header: magic[8], instr_size, code_size, hash[8], max_stack, ...
+printf '\377\377\377\377' | dd of="$DIR/.tlcache/lib.tlc" bs=1 seek=24 conv=notrunc 2> /dev/null
+expect_result "a compiled unit with an implausible max_stack"
+
+printf '\0\0\0\0' | dd of="$DIR/.tlcache/lib.tlc" bs=1 seek=24 conv=notrunc 2> /dev/null
+expect_result "a compiled unit with a max_stack which is too small"
+
+exit $FAILED
@@ -0,0 +1,54 @@
+#include <string>
+#include <iostream>
+
+#include <cstdint>
+
+#include "../incremental.hpp"
+#include "../sym_table.hpp"
+
+static bool failed = false;
+
+static void check(const bool cond, const char* const what){
+	if(!cond){
+		std::cerr << "FAILED: " << what << '\n';
+		failed = true;
+	}
+}
+
+static IntType eval(const IncrementalDocument& doc, const std::string& var){
+	SymbolTable sym_table{};
+	doc.ast().eval(sym_table);
+
+	return sym_table.get_or_insert(var);
+}
+
+int main(){
+	IncrementalDocument doc{"((set a 1) (set b (add a 2)))"};
+	check(doc.ok() && doc.diagnostics().empty(), "the initial code parses");
+	check(3 == eval(doc, "b"), "the initial code evaluates");
+
+	// Replaces the 1 within the first instruction.
+	check(doc.edit(TextEdit{8, 1, "5"}), "an edit within an instruction is reparsed");
+	check(7 == eval(doc, "b"), "the reparsed instruction is evaluated");
+
+	// A lone parenthesis as typed in an editor, the last AST is kept.
+	check(!doc.edit(TextEdit{11, 0, "("}), "unbalanced parentheses are a syntax error");
+	check(!doc.diagnostics().empty(), "the syntax error is reported");
+	check("((set a 5) ((set b (add a 2)))" == doc.code(), "the code is edited nevertheless");
+	check(7 == eval(doc, "b"), "the last AST is kept");
+
+	check(!doc.edit(TextEdit{8, 1, "6"}), "the code still has a syntax error");
+	check(doc.edit(TextEdit{11, 1, ""}), "removing the parenthesis fixes the code");
+	check(doc.diagnostics().empty(), "the fixed code has no diagnostics");
+	check("((set a 6) (set b (add a 2)))" == doc.code(), "every edit is applied");
+	check(8 == eval(doc, "b"), "the fixed code evaluates");
+
+	IncrementalDocument broken{"((set a 1)"};
+	check(!broken.ok() && !broken.diagnostics().empty(), "broken initial code is reported");
+	check(0 == eval(broken, "a"), "broken initial code has an empty AST");
+
+	check(broken.edit(TextEdit{10, 0, ")"}), "the initial code can be fixed");
+	check(1 == eval(broken, "a"), "the fixed code evaluates");
+
+	return failed ? 1 : 0;
+}
\ No newline at end of file
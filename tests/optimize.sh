@@ -0,0 +1,26 @@
+#!/bin/sh
+# The optimized program has to end with the same symbol table as the plain
+# one, the order of the symbols aside.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# Invariant operands which yield lists but are read as integers.
+printf '((set i 2) (while i ((set b (list (mul 5 (list 7 3)) i)) (set i (sub i 1)))))' > "$DIR/list_elem.tl"
+printf '((set i 2) (while i ((if (mul (max 0) (range 6)) ((set a 1)) ((set a 2))) (set i (sub i 1)))))' > "$DIR/list_cond.tl"
+printf '((set i 3) (while i ((set s (add s (sum (range 1000)))) (set i (sub i 1)))))' > "$DIR/list_value.tl"
+
+FAILED=0
+
+for PROG in list_elem list_cond list_value; do
+	"$BIN" --dump-sym "$DIR/$PROG.tl" 2>&1 | sort > "$DIR/plain.out"
+	"$BIN" --dump-sym --optimize "$DIR/$PROG.tl" 2>&1 | sort > "$DIR/optimized.out"
+
+	if ! cmp -s "$DIR/plain.out" "$DIR/optimized.out"; then
+		echo "FAILED: $PROG.tl differs with --optimize"
+		FAILED=1
+	fi
+done
+
+exit $FAILED
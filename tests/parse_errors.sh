@@ -0,0 +1,61 @@
+#!/bin/sh
+# Invalid chars are reported once and skipped, a missing operand is a syntax error.
+# Syntax errors in bodies which are parsed lazily stop the evaluation and fail the run.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+FAILED=0
+
+# Usage: expect <exit code> <program> <args...>
+expect(){
+	CODE=$1
+	printf '%s' "$2" > "$DIR/prog.tl"
+	shift 2
+
+	"$BIN" "$DIR/prog.tl" "$@" > /dev/null 2>&1
+	RES=$?
+
+	if [ "$RES" -ne "$CODE" ]; then
+		echo "FAILED: $(cat "$DIR/prog.tl") $* (exit code $RES, expected $CODE)"
+		FAILED=1
+	fi
+}
+
+expect 0 '((set l $ 1))'
+expect 255 '((set l (add 1 $)))'
+
+for OP in range len sum prod max; do
+	expect 255 "((set l ($OP \$)))"
+	expect 255 "((set l ($OP)))"
+done
+
+expect 255 '((set l (at 1 $)))'
+
+# Missing operands evaluate to 0 when recovering from syntax errors.
+expect 0 '((set x) (set y (add 1)) (set z (mul)) (if) (while) (set l (list 1 (sum))))' --try-recovery-from-syntax-errors
+expect 0 '((set l (list $)))'
+expect 0 '((set l (list 1 $ 2)))'
+
+# Programs with lists are parsed twice, see BytecodeParser.
+for PROG in '((set l (range $)))' '((set a $ 1) (set l (list 1)))' '((set a $ 1))'; do
+	printf '%s' "$PROG" > "$DIR/prog.tl"
+	CNT=$("$BIN" "$DIR/prog.tl" 2>&1 | grep -c 'invalid char')
+
+	if [ "$CNT" -ne 1 ]; then
+		echo "FAILED: $PROG (invalid char reported $CNT times)"
+		FAILED=1
+	fi
+done
+
+# The body of the loop would never decrement i without the syntax error.
+for ARGS in '' '--threads 4' '--optimize'; do
+	expect 255 '((set i 3) (while i ((set i (sub i 1)) (set x (add 1)))))' --lazy-parse $ARGS
+done
+
+expect 0 '((set i 3) (while i ((set i (sub i 1)) (set x $ 1))))' --lazy-parse
+expect 0 '((set i 0) (if i ((set x (add 1))) ((set y 2))))' --lazy-parse
+expect 255 '((set i 0) (if i ((set x (add 1))) ((set y 2))))' --lazy-parse --dump-ast
+
+exit $FAILED
@@ -0,0 +1,66 @@
+#!/bin/sh
+# A budget of N steps allows exactly N loop iterations, threads which never
+# loop take no steps from it. Every 1024 elements of a list operation take a
+# step, lists are limited in size and long list operations can time out.
+
+BIN=${1:-./theoLISP}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf '((set i 3) (while i ((set i (sub i 1)) (set result (add result 1)))))' > "$DIR/loop.tl"
+printf '((set l (list 1)) (set i 3) (while i ((set i (sub i 1)) (set result (add result 1)))))' > "$DIR/loop_ast.tl"
+printf '((set a 1) (set b 2) (set result (add a b)))' > "$DIR/no_loop.tl"
+printf '((set result (sum (range 1000000))))' > "$DIR/list_steps.tl"
+printf '((set l (range 100000000000)))' > "$DIR/list_size.tl"
+printf '((set l (range 10000000)) (set i 100000) (while i ((set s (sum (mul l 3))) (set i (sub i 1)))))' > "$DIR/list_timeout.tl"
+
+FAILED=0
+
+# Usage: expect <exit code> <args...>
+expect(){
+	CODE=$1
+	shift
+
+	"$BIN" "$@" > /dev/null 2>&1
+	RES=$?
+
+	if [ "$RES" -ne "$CODE" ]; then
+		echo "FAILED: $* (exit code $RES, expected $CODE)"
+		FAILED=1
+	fi
+}
+
+# Usage: expect_result <value> <args...>
+# The symbol table is dumped even if the evaluation stopped.
+expect_result(){
+	VALUE=$1
+	shift
+
+	if ! "$BIN" "$@" --dump-sym 2>&1 | grep -qx " result: $VALUE"; then
+		echo "FAILED: $* (result is not $VALUE)"
+		FAILED=1
+	fi
+}
+
+for PROG in loop loop_ast; do
+	expect 0 "$DIR/$PROG.tl" --max-steps 3
+	expect 255 "$DIR/$PROG.tl" --max-steps 2
+	expect 0 "$DIR/$PROG.tl" --max-steps 3 --threads 2
+	expect 0 "$DIR/$PROG.tl" --max-steps 4096 --threads 2
+
+	# The loop stops in front of the body which would exceed the budget.
+	expect_result 2 "$DIR/$PROG.tl" --max-steps 2
+	expect_result 2 "$DIR/$PROG.tl" --max-steps 2 --tree-walker
+	expect_result 3 "$DIR/$PROG.tl" --max-steps 3
+done
+
+expect 0 "$DIR/no_loop.tl" --max-steps 1 --threads 4
+
+# 976 steps for the range and as many for the sum.
+expect 0 "$DIR/list_steps.tl" --max-steps 1952
+expect 255 "$DIR/list_steps.tl" --max-steps 1951
+
+expect 255 "$DIR/list_size.tl"
+expect 255 "$DIR/list_timeout.tl" --timeout 100
+
+exit $FAILED
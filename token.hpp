@@ -1,13 +1,14 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
-#include <unordered_map>
+#include <utility>
 
 #include <string>
 #include <string_view>
 
 #include <ostream>
 
+#include <cstddef>
 #include <cstdint>
 
 #include "token_position.hpp"
@@ -50,18 +51,40 @@ static constexpr const char* const token_type_names[] = {
 	"WHILE"	
 };
 
+static constexpr size_t TOKEN_TYPE_CNT = sizeof(token_type_names) / sizeof(*token_type_names);
+
 static inline const char* token_type_name(const TokenType tt){
 	return token_type_names[static_cast<uint8_t>(tt)];
 }
 
-static const std::unordered_map<std::string_view, TokenType> keyword_table{
-	{"add", TokenType::ADD},
-	{"sub", TokenType::SUB},
-	{"mul", TokenType::MUL},
-	{"set", TokenType::SET},
-	{"if", TokenType::IF},
-	{"while", TokenType::WHILE},
-};
+// A switch instead of a hash table, as the lexer thread of a TokenPipe must
+// not touch objects which std::exit() destroys while the thread may still run.
+static inline bool find_keyword(const std::string_view& word, TokenType& res){
+	static constexpr std::pair<std::string_view, TokenType> keywords[] = {
+		{"add", TokenType::ADD},
+		{"sub", TokenType::SUB},
+		{"mul", TokenType::MUL},
+		{"set", TokenType::SET},
+		{"if", TokenType::IF},
+		{"while", TokenType::WHILE}
+	};
+
+	switch(word.size()){
+		case 2:
+		case 3:
+		case 5:
+			for(const auto& keyword : keywords){
+				if(keyword.first == word){
+					res = keyword.second;
+					return true;
+				}
+			}
+
+			return false;
+		default:
+			return false;
+	}
+}
 
 class Token{
 	private:
@@ -109,7 +132,7 @@ class Token{
 		}
 
 		friend std::ostream& operator<< (std::ostream& os, const Token& token){
-			return os << token.name() << " [" << token.value() << "] (" << token.pos() << ')';
+			return os << token.name() << " [" << token.value() << "] (offset: " << token.pos().offset() << ')';
 		}
 };
 
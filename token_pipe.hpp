@@ -0,0 +1,184 @@
+#ifndef TOKEN_PIPE_HPP
+#define TOKEN_PIPE_HPP
+
+#include <atomic>
+#include <thread>
+#include <memory>
+
+#include <string>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "token.hpp"
+#include "lexer.hpp"
+#include "token_position.hpp"
+
+// Lexes the code on a thread of its own, which runs ahead of the parser by
+// up to CAPACITY tokens. The tokens are passed through a lock-free single
+// producer, single consumer ring buffer in batches, i.e. the indices are
+// only published once per batch. The last token is CONTR_EOF, which is read
+// over and over again like from a Lexer. Invalid chars are passed on as
+// well and reported by the parser's lexer, so errors keep their order.
+class TokenPipe{
+	private:
+		static constexpr uint64_t CAPACITY = uint64_t{1} << 16;
+		static constexpr uint64_t BATCH = uint64_t{1} << 10;
+
+		// Below this size, starting the thread takes longer than lexing.
+		static constexpr size_t MIN_CODE_SIZE = size_t{1} << 20;
+
+		static constexpr uint32_t SPINS = 64;
+
+		// 12 instead of 32 bytes, the value is a range of the code.
+		struct PackedToken{
+			uint32_t offset;
+			uint32_t size;
+			TokenType type;
+
+			// Set for an invalid char at 'offset' instead of a token.
+			bool invalid;
+		};
+
+		const std::string& m_code;
+		Lexer& m_errors;
+
+		std::unique_ptr<PackedToken[]> m_ring;
+
+		// Written by the lexer thread, every token in front of it is complete.
+		alignas(64) std::atomic<uint64_t> m_tail;
+
+		// Written by the parser, every token in front of it has been read.
+		alignas(64) std::atomic<uint64_t> m_head;
+
+		std::atomic<bool> m_stop;
+
+		// Only used by the parser, 'm_avail' is the last tail it has seen.
+		alignas(64) uint64_t m_read;
+		uint64_t m_avail;
+
+		std::thread m_thread;
+
+	public:
+		// Invalid chars are reported to 'errors', which is not used for lexing,
+		// but whose statistics are recorded by the lexer thread.
+		// The code has to fit MAX_CODE_SIZE, see pays_off().
+		TokenPipe(const std::string& code, Lexer& errors):
+			m_code{code},
+			m_errors{errors},
+			m_ring{std::make_unique<PackedToken[]>(TokenPipe::CAPACITY)},
+			m_tail{0},
+			m_head{0},
+			m_stop{false},
+			m_read{0},
+			m_avail{0},
+			m_thread{}{
+
+			if(errors.stats())
+				errors.stats()->concurrent = true;
+
+			this->m_thread = std::thread{&TokenPipe::lex, this};
+		}
+
+		TokenPipe(const TokenPipe&) = delete;
+		TokenPipe& operator= (const TokenPipe&) = delete;
+
+		~TokenPipe(){
+			this->m_stop.store(true, std::memory_order_relaxed);
+			this->m_thread.join();
+		}
+
+		// Lexing the code of a single core in parallel only adds the synchronization.
+		// Offsets are 32 bits wide like a TokenPosition, hence the code must not
+		// exceed MAX_CODE_SIZE, which main checks before parsing.
+		static bool pays_off(const std::string& code){
+			return code.size() >= TokenPipe::MIN_CODE_SIZE
+				&& code.size() <= MAX_CODE_SIZE
+				&& std::thread::hardware_concurrency() > 1;
+		}
+
+		void read_next_token(Token& token){
+			while(true){
+				if(this->m_read == this->m_avail)
+					this->wait_for_tokens();
+
+				const PackedToken& packed = this->m_ring[this->m_read & (TokenPipe::CAPACITY - 1)];
+				const TokenPosition pos{packed.offset};
+
+				if(packed.invalid){
+					this->m_errors.report_invalid_char(pos);
+					this->advance();
+					continue;
+				}
+
+				token.set(packed.type, std::string_view{this->m_code.data() + packed.offset, packed.size}, pos);
+				if(TokenType::CONTR_EOF != packed.type)
+					this->advance();
+
+				return;
+			}
+		}
+
+	private:
+		// The lexer thread gets room for a batch at once.
+		inline void advance(){
+			if(0 == (++this->m_read & (TokenPipe::BATCH - 1)))
+				this->m_head.store(this->m_read, std::memory_order_release);
+		}
+
+		void wait_for_tokens(){
+			this->m_head.store(this->m_read, std::memory_order_release);
+
+			for(uint32_t spins = 0; ; ++spins){
+				this->m_avail = this->m_tail.load(std::memory_order_acquire);
+				if(this->m_read != this->m_avail)
+					return;
+
+				if(spins >= TokenPipe::SPINS)
+					std::this_thread::yield();
+			}
+		}
+
+		// Runs on the lexer thread until CONTR_EOF or the pipe is destroyed.
+		// Touches neither the parser nor objects of static storage duration.
+		void lex(){
+			Lexer lexer{this->m_code, 0, static_cast<uint32_t>(this->m_code.size()), nullptr};
+			lexer.record(this->m_errors.stats());
+
+			Token token{};
+
+			uint64_t tail = 0;
+			uint64_t head = 0;
+
+			bool eof = false;
+			while(!eof){
+				for(uint32_t spins = 0; tail + TokenPipe::BATCH - head > TokenPipe::CAPACITY; ++spins){
+					if(this->m_stop.load(std::memory_order_relaxed))
+						return;
+
+					head = this->m_head.load(std::memory_order_acquire);
+					if(spins >= TokenPipe::SPINS)
+						std::this_thread::yield();
+				}
+
+				for(const uint64_t end = tail + TokenPipe::BATCH; tail != end && !eof; ++tail){
+					PackedToken& packed = this->m_ring[tail & (TokenPipe::CAPACITY - 1)];
+
+					const bool valid = lexer.read_next_token_or_invalid(token);
+					packed = PackedToken{
+						token.pos().offset(),
+						static_cast<uint32_t>(token.value().size()),
+						token.type(),
+						!valid
+					};
+
+					eof = valid && TokenType::CONTR_EOF == token.type();
+				}
+
+				this->m_tail.store(tail, std::memory_order_release);
+			}
+		}
+};
+
+#endif	// TOKEN_PIPE_HPP
\ No newline at end of file
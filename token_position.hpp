@@ -1,48 +1,32 @@
 #ifndef TOKEN_POSITION_HPP
 #define TOKEN_POSITION_HPP
 
-#include <ostream>
-
+#include <cstddef>
 #include <cstdint>
 
+// Offsets are 32 bits wide, hence larger code is refused instead of being lexed in part.
+static constexpr size_t MAX_CODE_SIZE = UINT32_MAX;
+
+// Byte offset into the source code, see LineIndex for lines and columns.
 class TokenPosition{
 	private:
-		uint32_t m_col;
-		uint32_t m_line;
+		uint32_t m_offset;
 
 	public:
-		explicit TokenPosition(const uint32_t col = 1, const uint32_t line = 1):
-			m_col{col}, m_line{line}{
-		}
-
-		inline uint32_t col()const{
-			return this->m_col;
-		}
-
-		inline uint32_t line()const{
-			return this->m_line;
-		}
-
-		inline void inc_col(){
-			++this->m_col;
+		explicit TokenPosition(const uint32_t offset = 0): m_offset{offset}{
 		}
 
-		inline void inc_line(){
-			++this->m_line;
-			this->m_col = 0;
+		inline uint32_t offset()const{
+			return this->m_offset;
 		}
 
 		friend inline bool operator== (const TokenPosition& a, const TokenPosition& b){
-			return a.col() == b.col() && a.line() == b.line();
+			return a.offset() == b.offset();
 		}
 
 		friend inline bool operator!= (const TokenPosition& a, const TokenPosition& b){
 			return !(a == b);
 		}
-
-		friend std::ostream& operator<< (std::ostream& os, const TokenPosition pos){
-			return os << "ln: " << pos.line() << ", col: " << pos.col();
-		}
 };
 
 #endif	// TOKEN_POSITION_HPP
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef UNIT_HPP
+#define UNIT_HPP
+
+#include <filesystem>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fstream>
+#include <ostream>
+
+#include <cstdint>
+
+#include "token_position.hpp"
+
+#include "args.hpp"
+#include "util.hpp"
+
+// Imports are no keyword, hence a variable of the same name remains valid.
+static constexpr std::string_view IMPORT_SV{"import"};
+
+// A file imported by (import name), i.e. name.tl within the directory of the
+// program or the working directory if the program is not read from a file.
+// Imports within units are resolved against the same directory.
+struct Unit{
+	std::string name;
+	std::string path;
+	std::string code;
+	uint64_t hash;
+
+	static std::filesystem::path import_dir(){
+		return args.filename.empty()
+			? std::filesystem::path{"."}
+			: std::filesystem::path{args.filename}.parent_path();
+	}
+
+	static std::string path_of(const std::string_view& name){
+		return (Unit::import_dir() / (std::string{name} + ".tl")).string();
+	}
+
+	// Reports errors to 'err' and returns nullptr then.
+	static std::shared_ptr<const Unit> load(const std::string_view& name, std::ostream& err){
+		Unit unit{std::string{name}, Unit::path_of(name), std::string{}, 0};
+
+		if(!Unit::read(unit.path, unit.code)){
+			err << "error: Unable to import \'" << name << "\' (\'" << unit.path << "\' not found).\n";
+			return nullptr;
+		}
+
+		if(unit.code.size() > MAX_CODE_SIZE){
+			err << "error: Unable to import \'" << name << "\' (\'" << unit.path << "\' is larger than " << MAX_CODE_SIZE << " bytes).\n";
+			return nullptr;
+		}
+
+		unit.hash = fnv1a(unit.code);
+		return std::make_shared<const Unit>(std::move(unit));
+	}
+
+	// Also true if the file has been removed.
+	static bool changed(const std::string_view& name, const uint64_t hash){
+		std::string code{};
+		return !Unit::read(Unit::path_of(name), code) || fnv1a(code) != hash;
+	}
+
+	inline bool changed()const{
+		return Unit::changed(this->name, this->hash);
+	}
+
+	// Reads the file at once, like std::getline(file, code, '\0') would have.
+	static bool read(const std::string& path, std::string& code){
+		std::ifstream file{path, std::ios::binary | std::ios::ate};
+		if(!file)
+			return false;
+
+		code.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0).read(code.data(), static_cast<std::streamsize>(code.size()));
+		code.resize(std::min(code.find('\0'), static_cast<size_t>(file.gcount())));
+
+		return true;
+	}
+};
+
+// The units which are being imported, outermost first. A unit which
+// imports itself, directly or not, would be spliced in endlessly.
+class ImportChain{
+	private:
+		std::vector<std::string> m_paths;
+
+	public:
+		explicit ImportChain(): m_paths{}{
+		}
+
+		// Reports a cycle to 'err' and returns false then.
+		bool enter(const Unit& unit, std::ostream& err){
+			if(std::find(this->m_paths.begin(), this->m_paths.end(), unit.path) != this->m_paths.end()){
+				err << "error: Cyclic import of \'" << unit.name << "\' (";
+				for(const std::string& path : this->m_paths)
+					err << path << " -> ";
+				err << unit.path << ").\n";
+
+				return false;
+			}
+
+			this->m_paths.push_back(unit.path);
+			return true;
+		}
+};
+
+#endif	// UNIT_HPP
\ No newline at end of file
@@ -0,0 +1,306 @@
+#ifndef UNIX_SOCKET_HPP
+#define UNIX_SOCKET_HPP
+
+#include <string>
+#include <string_view>
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+
+#include <ostream>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A message consists of 'key: value' header lines, an empty line
+// and a body whose size is given by the 'length' header.
+class Message{
+	private:
+		std::vector<std::pair<std::string, std::string>> m_headers;
+		std::string m_body;
+
+	public:
+		explicit Message(): m_headers{}, m_body{}{
+		}
+
+		void set(const std::string& key, const std::string& value){
+			this->m_headers.emplace_back(key, value);
+		}
+
+		// Returns 'def' if the header is missing.
+		std::string get(const std::string_view& key, const std::string& def = std::string{})const{
+			for(const auto& header : this->m_headers){
+				if(header.first == key)
+					return header.second;
+			}
+
+			return def;
+		}
+
+		uint64_t get_uint(const std::string_view& key, const uint64_t def = 0)const{
+			const std::string value = this->get(key);
+			return value.empty() ? def : std::strtoull(value.c_str(), nullptr, 10);
+		}
+
+		inline bool get_flag(const std::string_view& key)const{
+			return this->get(key) == "1";
+		}
+
+		inline const std::string& body()const{
+			return this->m_body;
+		}
+
+		inline void set_body(std::string body){
+			this->m_body = std::move(body);
+		}
+
+		std::string serialize()const{
+			std::string res{};
+			for(const auto& header : this->m_headers){
+				if(header.first != "length")
+					res += header.first + ": " + header.second + '\n';
+			}
+
+			res += "length: " + std::to_string(this->m_body.size()) + "\n\n";
+			return res + this->m_body;
+		}
+
+		// Parses a header line, returns false if it is malformed.
+		bool add_header_line(const std::string_view& line){
+			const size_t sep = line.find(": ");
+			if(std::string_view::npos == sep)
+				return false;
+
+			this->set(std::string{line.substr(0, sep)}, std::string{line.substr(sep + 2)});
+			return true;
+		}
+};
+
+// Owns a stream socket of the AF_UNIX domain.
+class UnixSocket{
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Longer header lines and more header lines make a message malformed.
+		static constexpr size_t MAX_LINE = 4096;
+		static constexpr size_t MAX_HEADERS = 64;
+
+		int m_fd;
+		std::string m_buffer;
+
+		// 0 means unlimited.
+		uint32_t m_timeout_ms;
+
+	public:
+		explicit UnixSocket(const int fd = -1): m_fd{fd}, m_buffer{}, m_timeout_ms{0}{
+		}
+
+		UnixSocket(UnixSocket&& other): m_fd{other.m_fd}, m_buffer{std::move(other.m_buffer)}, m_timeout_ms{other.m_timeout_ms}{
+			other.m_fd = -1;
+		}
+
+		UnixSocket& operator= (UnixSocket&& other){
+			std::swap(this->m_fd, other.m_fd);
+			std::swap(this->m_buffer, other.m_buffer);
+			std::swap(this->m_timeout_ms, other.m_timeout_ms);
+
+			return *this;
+		}
+
+		UnixSocket(const UnixSocket&) = delete;
+		UnixSocket& operator= (const UnixSocket&) = delete;
+
+		~UnixSocket(){
+			if(this->valid())
+				::close(this->m_fd);
+		}
+
+		inline bool valid()const{
+			return this->m_fd >= 0;
+		}
+
+		// Reading a whole message fails if it takes longer than 'timeout_ms'.
+		inline void set_timeout(const uint32_t timeout_ms){
+			this->m_timeout_ms = timeout_ms;
+		}
+
+		// A stale socket file of a previous server is replaced.
+		static UnixSocket listen(const std::string& path, std::ostream& err){
+			sockaddr_un addr{};
+			if(!UnixSocket::make_addr(path, addr, err))
+				return UnixSocket{};
+
+			struct stat st{};
+			if(0 == ::stat(path.c_str(), &st) && S_ISSOCK(st.st_mode))
+				::unlink(path.c_str());
+
+			UnixSocket sock{::socket(AF_UNIX, SOCK_STREAM, 0)};
+			if(!sock.valid()
+				|| 0 != ::bind(sock.m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))
+				|| 0 != ::listen(sock.m_fd, SOMAXCONN)){
+
+				UnixSocket::report(err, "listen on", path);
+				return UnixSocket{};
+			}
+
+			return sock;
+		}
+
+		static UnixSocket connect(const std::string& path, std::ostream& err){
+			sockaddr_un addr{};
+			if(!UnixSocket::make_addr(path, addr, err))
+				return UnixSocket{};
+
+			UnixSocket sock{::socket(AF_UNIX, SOCK_STREAM, 0)};
+			if(!sock.valid() || 0 != ::connect(sock.m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))){
+				UnixSocket::report(err, "connect to", path);
+				return UnixSocket{};
+			}
+
+			return sock;
+		}
+
+		UnixSocket accept()const{
+			int fd{};
+			do{
+				fd = ::accept(this->m_fd, nullptr, nullptr);
+			}while(fd < 0 && EINTR == errno);
+
+			return UnixSocket{fd};
+		}
+
+		bool write(const std::string_view& data)const{
+			size_t written = 0;
+			while(written < data.size()){
+				// MSG_NOSIGNAL: A client which went away must not kill the server.
+				const ssize_t res = ::send(this->m_fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+				if(res < 0 && EINTR == errno)
+					continue;
+				if(res <= 0)
+					return false;
+
+				written += static_cast<size_t>(res);
+			}
+
+			return true;
+		}
+
+		inline bool write(const Message& msg)const{
+			return this->write(msg.serialize());
+		}
+
+		// Fails for bodies larger than 'max_body' bytes.
+		bool read(Message& msg, const uint64_t max_body = UINT64_MAX){
+			const Clock::time_point deadline = (0 == this->m_timeout_ms)
+				? Clock::time_point::max()
+				: Clock::now() + std::chrono::milliseconds{this->m_timeout_ms};
+
+			std::string line{};
+			for(size_t headers = 0; ; ++headers){
+				if(!this->read_line(line, deadline))
+					return false;
+				if(line.empty())
+					break;
+
+				if(headers >= MAX_HEADERS || !msg.add_header_line(line))
+					return false;
+			}
+
+			const uint64_t length = msg.get_uint("length");
+			if(length > max_body)
+				return false;
+
+			std::string body{};
+			if(!this->read_exact(body, static_cast<size_t>(length), deadline))
+				return false;
+
+			msg.set_body(std::move(body));
+			return true;
+		}
+
+	private:
+		static bool make_addr(const std::string& path, sockaddr_un& addr, std::ostream& err){
+			addr.sun_family = AF_UNIX;
+			if(path.size() >= sizeof(addr.sun_path)){
+				err << "error: Socket path \'" << path << "\' is too long.\n";
+				return false;
+			}
+
+			std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+			return true;
+		}
+
+		static void report(std::ostream& err, const char* const what, const std::string& path){
+			err << "error: Unable to " << what << " \'" << path << "\' (" << std::strerror(errno) << ").\n";
+		}
+
+		// Fails once the deadline has passed.
+		bool fill(const Clock::time_point deadline){
+			char chunk[4096];
+
+			ssize_t res{};
+			do{
+				if(Clock::time_point::max() != deadline){
+					const int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+					if(left <= 0)
+						return false;
+
+					pollfd fd{this->m_fd, POLLIN, 0};
+					res = ::poll(&fd, 1, static_cast<int>(std::min<int64_t>(left, INT32_MAX)));
+					if(res < 0)
+						continue;
+					if(0 == res)
+						return false;
+				}
+
+				res = ::recv(this->m_fd, chunk, sizeof(chunk), 0);
+			}while(res < 0 && EINTR == errno);
+
+			if(res <= 0)
+				return false;
+
+			this->m_buffer.append(chunk, static_cast<size_t>(res));
+			return true;
+		}
+
+		bool read_line(std::string& line, const Clock::time_point deadline){
+			size_t end{};
+			while(std::string::npos == (end = this->m_buffer.find('\n'))){
+				if(this->m_buffer.size() > MAX_LINE || !this->fill(deadline))
+					return false;
+			}
+
+			if(end > MAX_LINE)
+				return false;
+
+			line = this->m_buffer.substr(0, end);
+			this->m_buffer.erase(0, end + 1);
+
+			return true;
+		}
+
+		bool read_exact(std::string& data, const size_t size, const Clock::time_point deadline){
+			while(this->m_buffer.size() < size){
+				if(!this->fill(deadline))
+					return false;
+			}
+
+			data = this->m_buffer.substr(0, size);
+			this->m_buffer.erase(0, size);
+
+			return true;
+		}
+};
+
+#endif	// UNIX_SOCKET_HPP
\ No newline at end of file
@@ -6,17 +6,29 @@
 
 #include <sstream>
 #include <ostream>
+#include <iomanip>
 
 #include <memory>
 #include <iterator>
+#include <charconv>
+#include <system_error>
 
 #include <cstddef>
+#include <cstdint>
 
 #include "types.hpp"
 
 static const std::string_view ZERO_SV{"0"};
 static const std::string_view ERR_IDENT_SV{"__error__"};
 
+// Identifiers produced by the lexer always start with a lower case letter,
+// hence names with this prefix never collide with user defined variables.
+static const std::string_view INTERNAL_PREFIX_SV{"__"};
+
+static inline bool is_internal_name(const std::string_view& name){
+	return name.substr(0, INTERNAL_PREFIX_SV.size()) == INTERNAL_PREFIX_SV;
+}
+
 template <typename IT>
 static inline std::string_view sv_from_range(const IT beg, const IT end){
 	return std::string_view{
@@ -25,15 +37,34 @@ static inline std::string_view sv_from_range(const IT beg, const IT end){
 	};
 }
 
+// Integers which are out of range saturate, like with operator>>.
 static IntType sv_to_int(const std::string_view& sv){
 	IntType res{};
-	std::stringstream ss{};
-
-	ss << sv;
-	ss >> res;
+	if(std::errc::result_out_of_range == std::from_chars(sv.data(), sv.data() + sv.size(), res).ec)
+		res = ('-' == sv.front()) ? INT64_MIN : INT64_MAX;
 
 	return res;
+}
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// FNV-1a, pass the previous hash to continue hashing.
+static inline uint64_t fnv1a(const std::string_view& sv, uint64_t hash = FNV_OFFSET_BASIS){
+	for(const char chr : sv){
+		hash ^= static_cast<uint8_t>(chr);
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+// Zero padded, e.g. for hashes within file names.
+static std::string to_hex(const uint64_t value){
+	std::ostringstream oss{};
+	oss << std::hex << std::setw(16) << std::setfill('0') << value;
 
+	return oss.str();
 }
 
 static inline void print_list(std::ostream& /*os*/){
@@ -0,0 +1,69 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include <ostream>
+
+#include <cstddef>
+
+#include "types.hpp"
+
+using IntList = std::vector<IntType>;
+
+// The value of a variable or an expression: an integer or a list. Lists are
+// immutable and shared by every copy of the value, hence copying a value
+// (e.g. reading a variable) never copies the elements of a list.
+class Value{
+	private:
+		IntType m_int;
+		std::shared_ptr<const IntList> m_list;
+
+	public:
+		explicit Value(const IntType value = IntType{}): m_int{value}, m_list{}{
+		}
+
+		explicit Value(std::shared_ptr<const IntList> list): m_int{}, m_list{std::move(list)}{
+		}
+
+		// Avoids a temporary Value when assigning an integer.
+		inline Value& operator= (const IntType value){
+			if(this->m_list)
+				this->m_list.reset();
+
+			this->m_int = value;
+			return *this;
+		}
+
+		inline DataType type()const{
+			return this->m_list ? DataType::LIST : DataType::INTEGER;
+		}
+
+		inline bool is_list()const{
+			return static_cast<bool>(this->m_list);
+		}
+
+		// A list counts as its length where an integer is expected.
+		inline IntType as_int()const{
+			return this->m_list ? static_cast<IntType>(this->m_list->size()) : this->m_int;
+		}
+
+		inline const IntList& list()const{
+			return *this->m_list;
+		}
+
+		friend std::ostream& operator<< (std::ostream& os, const Value& value){
+			if(!value.m_list)
+				return os << value.m_int;
+
+			os << '[';
+			for(size_t i = 0; i < value.m_list->size(); ++i)
+				os << ((0 == i) ? "" : ", ") << (*value.m_list)[i];
+
+			return os << ']';
+		}
+};
+
+#endif	// VALUE_HPP
\ No newline at end of file
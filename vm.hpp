@@ -0,0 +1,224 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include "bytecode.hpp"
+#include "sym_table.hpp"
+#include "exec_limits.hpp"
+#include "types.hpp"
+
+enum class VMStatus: uint8_t{
+	HALTED,
+	STOPPED,	// an execution limit is exceeded
+	YIELDED		// the time slice is used up
+};
+
+// Executes a Program. Unlike the evaluation of the AST, the state is explicit:
+// in front of a loop head it consists of the pc and the slots only and can be
+// saved and restored, see checkpoint.hpp, or resumed later, see scheduler.hpp.
+class VM{
+	public:
+		using SlotValues = std::vector<std::pair<std::string, IntType>>;
+
+	private:
+		// The safe point is reached every SAFE_POINT_INTERVAL loop iterations.
+		static constexpr uint32_t SAFE_POINT_INTERVAL = 1024;
+
+		const Program& m_program;
+		uint32_t m_pc;
+
+		std::vector<IntType> m_slots;
+		std::vector<IntType> m_stack;
+
+		// The slots in the order of their first access, i.e. the order in
+		// which the evaluation of the AST inserts them into the symbol table.
+		std::vector<uint8_t> m_accessed;
+		std::vector<uint32_t> m_access_order;
+
+	public:
+		explicit VM(const Program& program):
+			m_program{program},
+			m_pc{0},
+			m_slots(program.slot_names().size(), IntType{}),
+			m_stack(program.max_stack(), IntType{}),
+			m_accessed(program.slot_names().size(), 0),
+			m_access_order{}{
+		}
+
+		inline uint32_t pc()const{
+			return this->m_pc;
+		}
+
+		inline IntType slot(const uint32_t slot)const{
+			return this->m_slots[slot];
+		}
+
+		inline void set_slot(const uint32_t slot, const IntType value){
+			this->m_slots[slot] = value;
+		}
+
+		// Starts the program over with every variable 0. The order of the
+		// first accesses is kept, it is only of interest for a single run.
+		inline void reset(){
+			std::fill(this->m_slots.begin(), this->m_slots.end(), IntType{});
+			this->m_pc = 0;
+		}
+
+		// The accessed slots in the order of their first access.
+		SlotValues slot_values()const{
+			SlotValues res{};
+			res.reserve(this->m_access_order.size());
+
+			for(const uint32_t slot : this->m_access_order)
+				res.emplace_back(this->m_program.slot_names()[slot], this->m_slots[slot]);
+
+			return res;
+		}
+
+		// Returns false if the state does not belong to the program. It is saved
+		// in front of a loop head, where the stack is empty, so any other pc is
+		// rejected as well.
+		bool restore(const uint32_t pc, const SlotValues& values){
+			const std::vector<Instr>& code = this->m_program.code();
+			if(std::none_of(code.begin(), code.end(), [pc](const Instr& instr){ return OpCode::LOOP == instr.op && pc == instr.arg; }))
+				return false;
+
+			std::unordered_map<std::string_view, uint32_t> slots{};
+			for(uint32_t slot = 0; slot < this->m_program.slot_names().size(); ++slot)
+				slots.emplace(this->m_program.slot_names()[slot], slot);
+
+			for(const auto& value : values){
+				const auto res = slots.find(value.first);
+				if(res == slots.end() || 0 != this->m_accessed[res->second])
+					return false;
+
+				this->access(res->second);
+				this->m_slots[res->second] = value.second;
+			}
+
+			this->m_pc = pc;
+			return true;
+		}
+
+		// Runs until the program halts (true) or an execution limit is exceeded
+		// (false), in which case the VM stays in front of the loop head and can
+		// be resumed. 'safe_point' is called with the same guarantee regularly.
+		template <typename F>
+		bool run(F&& safe_point){
+			const VMStatus status = this->execute(SAFE_POINT_INTERVAL, [&safe_point](const VM& vm){
+				safe_point(vm);
+				return true;
+			});
+
+			return VMStatus::HALTED == status;
+		}
+
+		inline bool run(){
+			return this->run([](const VM&){});
+		}
+
+		// Runs at most 'iterations' loop iterations (at least 1), the VM stays
+		// in front of the loop head if it yields.
+		inline VMStatus run_slice(const uint32_t iterations){
+			return this->execute(std::max(iterations, 1u), [](const VM&){
+				return false;
+			});
+		}
+
+		// Inserts the accessed slots like the evaluation of the AST would have.
+		void store(SymbolTable& sym_table)const{
+			for(const uint32_t slot : this->m_access_order)
+				sym_table.update(this->m_program.slot_names()[slot], this->m_slots[slot]);
+		}
+
+	private:
+		// 'safe_point' is called every 'interval' loop iterations and
+		// returns false if the execution has to yield.
+		template <typename F>
+		VMStatus execute(const uint32_t interval, F&& safe_point){
+			const Instr* const code = this->m_program.code().data();
+			IntType* const slots = this->m_slots.data();
+			IntType* const stack = this->m_stack.data();
+
+			uint32_t pc = this->m_pc;
+			uint32_t sp = 0;
+			uint32_t countdown = interval;
+
+			while(true){
+				const Instr& instr = code[pc++];
+				switch(instr.op){
+					case OpCode::PUSH:
+						stack[sp++] = instr.value;
+						break;
+					case OpCode::LOAD:
+						if(0 == this->m_accessed[instr.arg])
+							this->access(instr.arg);
+
+						stack[sp++] = slots[instr.arg];
+						break;
+					case OpCode::STORE:
+						if(0 == this->m_accessed[instr.arg])
+							this->access(instr.arg);
+
+						slots[instr.arg] = stack[--sp];
+						break;
+					case OpCode::ADD:
+						--sp;
+						stack[sp - 1] += stack[sp];
+						break;
+					case OpCode::SUB:
+						--sp;
+						stack[sp - 1] -= stack[sp];
+						break;
+					case OpCode::MUL:
+						--sp;
+						stack[sp - 1] *= stack[sp];
+						break;
+					case OpCode::JUMP:
+						pc = instr.arg;
+						break;
+					case OpCode::JUMP_IF_NOT_POS:
+						if(stack[--sp] <= IntType{})
+							pc = instr.arg;
+						break;
+					case OpCode::ENTER:
+						// The condition has no side effects, it is evaluated again on resume.
+						if(!exec_limits.tick()){
+							this->m_pc = instr.arg;
+							return VMStatus::STOPPED;
+						}
+						break;
+					case OpCode::LOOP:
+						pc = instr.arg;
+
+						if(0 == --countdown){
+							countdown = interval;
+
+							this->m_pc = pc;
+							if(!safe_point(static_cast<const VM&>(*this)))
+								return VMStatus::YIELDED;
+						}
+						break;
+					case OpCode::HALT:
+						this->m_pc = pc - 1;
+						return VMStatus::HALTED;
+				}
+			}
+		}
+
+		inline void access(const uint32_t slot){
+			this->m_accessed[slot] = 1;
+			this->m_access_order.push_back(slot);
+		}
+};
+
+#endif	// VM_HPP
\ No newline at end of file